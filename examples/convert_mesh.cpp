@@ -0,0 +1,93 @@
+#include <Ak/ObjMeshModel.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+/// Prints the vertex cache statistics of a whole model, weighting each shape by its number of triangles (for the ACMR)
+/// and vertices (for the ATVR).
+void
+printVertexCacheStats(const char* label, const Ak::ObjMeshModel& objMeshModel)
+{
+  double missCount = 0;
+
+  double triangleCount = 0;
+
+  double vertexCount = 0;
+
+  for (const auto& shapeView : objMeshModel.getShapeViews()) {
+
+    const auto stats = Ak::ObjMeshModel::analyzeVertexCache(shapeView);
+
+    missCount += double(stats.acmr) * double(shapeView.triangleCount());
+
+    triangleCount += double(shapeView.triangleCount());
+
+    vertexCount += double(shapeView.vertexCount);
+  }
+
+  if (triangleCount > 0)
+    std::printf("%s: ACMR %.3f, ATVR %.3f\n", label, missCount / triangleCount, missCount / vertexCount);
+}
+
+} // namespace
+
+/// Converts an OBJ file to the binary mesh format of @ref Ak::ObjMeshModel, so that the examples can load it without
+/// parsing any text. Indexed models are also optimized for the vertex cache before they are saved.
+int
+main(int argc, char** argv)
+{
+  const bool indexed = (argc == 4) && (std::strcmp(argv[3], "--indexed") == 0);
+
+  if ((argc != 3) && !indexed) {
+    std::fprintf(stderr, "usage: %s <model.obj> <model.akmesh> [--indexed]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  Ak::ObjMeshModel objMeshModel;
+
+  const auto loadStart = std::chrono::steady_clock::now();
+
+  if (!objMeshModel.loadFile(argv[1], indexed)) {
+    std::fprintf(stderr, "%s: failed to load '%s'\n", argv[0], argv[1]);
+    return EXIT_FAILURE;
+  }
+
+  if (indexed) {
+
+    printVertexCacheStats("before optimization", objMeshModel);
+
+    objMeshModel.optimizeVertexCache();
+
+    printVertexCacheStats("after optimization", objMeshModel);
+  }
+
+  if (!objMeshModel.saveBinary(argv[2])) {
+    std::fprintf(stderr, "%s: failed to save '%s'\n", argv[0], argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  // Load the file back, both to check it and to compare the load times.
+
+  const auto binaryStart = std::chrono::steady_clock::now();
+
+  Ak::ObjMeshModel binaryModel;
+
+  if (!binaryModel.loadBinary(argv[2]) || (binaryModel.computeHash() != objMeshModel.computeHash())) {
+    std::fprintf(stderr, "%s: '%s' does not match the original model\n", argv[0], argv[2]);
+    return EXIT_FAILURE;
+  }
+
+  const auto binaryEnd = std::chrono::steady_clock::now();
+
+  using Milliseconds = std::chrono::duration<double, std::milli>;
+
+  std::printf("OBJ load and save: %.3f ms\n", Milliseconds(binaryStart - loadStart).count());
+
+  std::printf("binary load and check: %.3f ms\n", Milliseconds(binaryEnd - binaryStart).count());
+
+  return EXIT_SUCCESS;
+}
@@ -1,20 +1,29 @@
+#include <Ak/AsyncObjMeshLoader.h>
 #include <Ak/FlyCamera.h>
 #include <Ak/GLFW.h>
+#include <Ak/MappedFile.h>
 #include <Ak/ObjMeshModel.h>
 #include <Ak/OpenGLHRTMeshRenderProgram.h>
+#include <Ak/OpenGLMeshBatch.h>
+#include <Ak/OpenGLMeshCullingPass.h>
 #include <Ak/OpenGLTexture2D.h>
 #include <Ak/OpenGLTextureQuadPair.h>
-#include <Ak/OpenGLVertexBuffer.h>
 #include <Ak/RTMeshModel.h>
 #include <Ak/SingleWindowGLFWApp.h>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
+#include <chrono>
+#include <future>
+#include <optional>
 #include <random>
+#include <string>
 #include <vector>
 
 #include <cassert>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 
@@ -70,11 +79,6 @@ private:
   std::shared_ptr<Framebuffer> m_framebuffer;
 };
 
-struct OpenGLShape final
-{
-  Ak::OpenGLVertexBuffer<glm::vec3, glm::vec3, glm::vec2> vertexBuffer;
-};
-
 class CPPIndirectLightingPass final
 {
 public:
@@ -104,17 +108,32 @@ public:
                int h,
                std::vector<glm::vec3>& outTex) const
   {
+    const int tileHeight = 16;
+
+    std::vector<Ray> rays;
+
+    std::vector<std::optional<AnyHit>> hits;
+
+    for (int yTile = 0; yTile < h; yTile += tileHeight) {
+
+      const int texelCount = std::min(tileHeight, h - yTile) * w;
+
+      const int texelOffset = yTile * w;
+
+      rays.resize(texelCount * samplesPerTexel());
+
+      hits.resize(texelCount * samplesPerTexel());
+
 #pragma omp parallel for
-    for (int y = 0; y < h; y++) {
+      for (int i = 0; i < texelCount; i++) {
 
-      for (int x = 0; x < w; x++) {
+        const int x = (texelOffset + i) % w;
+        const int y = (texelOffset + i) / w;
 
         const float u = float(x + 0.5f) / w;
         const float v = float(y + 0.5f) / h;
 
-        const int texelIndex = (y * w) + x;
-
-        const glm::vec4 normalDepth = normalDepthTex[texelIndex];
+        const glm::vec4 normalDepth = normalDepthTex[texelOffset + i];
 
         const float xNDC = ((u * 2) - 1);
         const float yNDC = ((v * 2) - 1);
@@ -124,75 +143,72 @@ public:
 
         const glm::vec3 normal(normalDepth.x, normalDepth.y, normalDepth.z);
 
+        Ray* texelRays = &rays[i * samplesPerTexel()];
+
         if (normalDepth.w == 1.0f)
-          outTex[texelIndex] = glm::vec3(0, 0, 0);
+          generateEmptyRays(texelRays);
         else
-          outTex[texelIndex] = computeTexel(normalizeByW(worldSpacePoint), (normal * 2.0f) - 1.0f, x, y);
+          generateRays(normalizeByW(worldSpacePoint), (normal * 2.0f) - 1.0f, x, y, texelRays);
+      }
+
+      m_rtMeshModel.findAnyHits(rays.data(), hits.data(), rays.size());
+
+#pragma omp parallel for
+      for (int i = 0; i < texelCount; i++) {
+
+        if (normalDepthTex[texelOffset + i].w == 1.0f)
+          outTex[texelOffset + i] = glm::vec3(0, 0, 0);
+        else
+          outTex[texelOffset + i] = resolveTexel(&hits[i * samplesPerTexel()]);
       }
     }
   }
 
 private:
-  static constexpr int wrap(int x, int min, int max)
-  {
-    if (x < min)
-      return max - x;
-    else if (x > max)
-      return min + (x - max);
-    else
-      return x;
-  }
-
-  glm::vec3 computeTexel(const glm::vec3& pos, const glm::vec3& norm, int xCenter, int yCenter) const
-  {
-    std::seed_seq seed{ 1234, xCenter, yCenter };
+  using Ray = Ak::RTMeshModel<float>::Ray;
 
-    std::minstd_rand rng(seed);
+  using AnyHit = Ak::RTMeshModel<float>::AnyHit;
 
-    const int radius = 1;
+  using Vec3 = Ak::RTMeshModel<float>::Vec3;
 
-    const int xMin = xCenter - radius;
-    const int yMin = yCenter - radius;
+  static constexpr int samplesPerTexel() { return 9; }
 
-    const int xMax = xCenter + radius;
-    const int yMax = yCenter + radius;
+  static void generateRays(const glm::vec3& pos, const glm::vec3& norm, int x, int y, Ray* rays)
+  {
+    std::seed_seq seed{ 1234, x, y };
 
-    glm::vec3 sampleSum(0, 0, 0);
+    std::minstd_rand rng(seed);
 
-    for (int y = yMin; y <= yMax; y++) {
+    const float shadowBias = 0.00001;
 
-      for (int x = xMin; x <= xMax; x++) {
+    for (int i = 0; i < samplesPerTexel(); i++) {
 
-        const int xTexel = wrap(x, 0, 640);
-        const int yTexel = wrap(y, 0, 480);
+      const glm::vec3 rayDir = sampleHemisphere(norm, rng);
 
-        sampleSum += computeSample(pos, sampleHemisphere(norm, rng));
-      }
+      rays[i] = Ray(Vec3(pos.x, pos.y, pos.z), Vec3(rayDir.x, rayDir.y, rayDir.z), shadowBias, 100.0f);
     }
-
-    const int sampleCount = ((xMax - xMin) + 1) * ((yMax - yMin) + 1);
-
-    const glm::vec3 out = sampleSum * (1.0f / sampleCount);
-
-    return glm::clamp(out, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
   }
 
-  glm::vec3 computeSample(const glm::vec3& pos, const glm::vec3& rayDir) const
+  /// Fills the rays of a texel that has no geometry with rays that are rejected at the root of the BVH, so that the
+  /// batch can still be traced in a single call.
+  static void generateEmptyRays(Ray* rays)
   {
-    using Ray = bvh::Ray<float>;
-
-    using Vec3 = bvh::Vector3<float>;
+    for (int i = 0; i < samplesPerTexel(); i++)
+      rays[i] = Ray(Vec3(0, 0, 0), Vec3(0, 0, 1), 1.0f, 0.0f);
+  }
 
-    const float shadowBias = 0.00001;
+  static glm::vec3 resolveTexel(const std::optional<AnyHit>* hits)
+  {
+    glm::vec3 sampleSum(0, 0, 0);
 
-    const glm::vec3 rayOrg = pos; // + (rayDir * shadowBias);
+    for (int i = 0; i < samplesPerTexel(); i++) {
+      if (!hits[i])
+        sampleSum += glm::vec3(1, 1, 1);
+    }
 
-    const Ray ray(Vec3(rayOrg.x, rayOrg.y, rayOrg.z), Vec3(rayDir.x, rayDir.y, rayDir.z), shadowBias, 100.0f);
+    const glm::vec3 out = sampleSum * (1.0f / samplesPerTexel());
 
-    if (m_rtMeshModel.findAnyHit(ray))
-      return glm::vec3(0, 0, 0);
-    else
-      return glm::vec3(1, 1, 1);
+    return glm::clamp(out, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1));
   }
 
   template<typename Rng>
@@ -224,37 +240,28 @@ public:
 
   static constexpr int fbHeight() { return 480; }
 
-  App(Ak::ObjMeshModel&& objMeshModel, Ak::GLFWWindow& window)
+  /// Opens the window right away. The model is either given here, or loaded in the background with @ref
+  /// App::loadInBackground, in which case its shapes show up as they are read.
+  ///
+  /// The BVH cache is keyed on the model file rather than on its contents, so a warm cache is loaded right away, while
+  /// the model is still being parsed.
+  App(Ak::ObjMeshModel&& objMeshModel, const std::string& modelPath, Ak::GLFWWindow& window)
     : m_objMeshModel(std::move(objMeshModel))
+    , m_bvhCachePath(modelPath + ".akbvh")
+    , m_bvhCacheKey(Ak::computeFileVersionKey(modelPath.c_str()))
   {
-    m_rtMeshModel.useObjModel(m_objMeshModel);
-
-    m_rtMeshModel.commit();
-
     m_camera.applyRelativeMove(glm::vec3(0, 1, 5));
 
     window.registerEventObserver(m_camera.makeGLFWEventProxy());
 
     std::vector<Ak::ObjMeshModel::ShapeView> shapeViews = m_objMeshModel.getShapeViews();
 
-    for (const Ak::ObjMeshModel::ShapeView& shapeView : shapeViews) {
-
-      OpenGLShape openGLShape;
-
-      openGLShape.vertexBuffer.bind();
-
-      openGLShape.vertexBuffer.allocate(shapeView.vertexCount, GL_STATIC_DRAW);
+    for (const Ak::ObjMeshModel::ShapeView& shapeView : shapeViews)
+      m_meshBatch.addShape(shapeView);
 
-      using OpenGLVertex = Ak::OpenGLVertexBuffer<glm::vec3, glm::vec3, glm::vec2>::Vertex;
+    m_objMeshModelLoaded = !shapeViews.empty();
 
-      static_assert(sizeof(OpenGLVertex) == (sizeof(float) * 8));
-
-      openGLShape.vertexBuffer.write(0, (OpenGLVertex*)shapeView.vertexBuffer, shapeView.vertexCount);
-
-      openGLShape.vertexBuffer.unbind();
-
-      m_openGLShapes.emplace_back(std::move(openGLShape));
-    }
+    startLoadingBvhCache();
 
     std::shared_ptr<Ak::GLFWEventObserver> framebufferResizer(new FramebufferResizer(m_framebuffer));
 
@@ -269,8 +276,12 @@ public:
 
   const char* title() const noexcept override { return "C++ Path Tracer"; }
 
+  void loadInBackground(const std::string& objPath) { m_objMeshLoader.start(objPath.c_str()); }
+
   void requestAnimationFrame(Ak::GLFWWindow& window) override
   {
+    pollLoading(window);
+
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
     const glm::mat4 proj = glm::perspective(glm::radians(45.0f), window.aspectRatio(), 0.1f, 100.0f);
@@ -279,35 +290,52 @@ public:
 
     const glm::mat4 mvp = proj * view;
 
+    assert(m_cullingPass.isInitialized());
+
+    m_cullingPass.cull(m_meshBatch, mvp);
+
     m_hrtMeshRenderProgram.bind();
 
     assert(m_hrtMeshRenderProgram.isInitialized());
 
+    m_hrtMeshRenderProgram.clear();
+
     m_hrtMeshRenderProgram.setMVP(mvp);
 
-    for (OpenGLShape& shape : m_openGLShapes) {
+    m_meshBatch.bind();
 
-      shape.vertexBuffer.bind();
+    m_hrtMeshRenderProgram.render(m_meshBatch);
 
-      m_hrtMeshRenderProgram.render(shape.vertexBuffer);
-
-      shape.vertexBuffer.unbind();
-    }
+    m_meshBatch.unbind();
 
     m_hrtMeshRenderProgram.unbind();
 
     Ak::OpenGLTexture2D* normalDepthTexture = m_hrtMeshRenderProgram.normalDepthTexture();
 
+    m_cullingPass.updateDepthPyramid(*normalDepthTexture, fbWidth(), fbHeight());
+
     std::vector<glm::vec4> normalDepthData(fbWidth() * fbHeight());
     normalDepthTexture->bind();
     normalDepthTexture->read(0, &normalDepthData[0]);
     normalDepthTexture->unbind();
 
-    CPPIndirectLightingPass indirectLightingPass(m_rtMeshModel);
-
     std::vector<glm::vec3> out(fbWidth() * fbHeight());
 
-    indirectLightingPass.execute(normalDepthData, glm::inverse(mvp), fbWidth(), fbHeight(), out);
+    if (m_rtMeshModelReady) {
+
+      CPPIndirectLightingPass indirectLightingPass(m_rtMeshModel);
+
+      indirectLightingPass.execute(normalDepthData, glm::inverse(mvp), fbWidth(), fbHeight(), out);
+
+    } else {
+
+      // Until the BVH is ready, the normals are shown instead, so that the shapes can be seen as they are uploaded.
+
+      for (std::size_t i = 0; i < out.size(); i++) {
+        const glm::vec4& normalDepth = normalDepthData[i];
+        out[i] = (normalDepth.w == 1.0f) ? glm::vec3(0, 0, 0) : glm::vec3(normalDepth.x, normalDepth.y, normalDepth.z);
+      }
+    }
 
     m_framebuffer->colorTexture.bind();
 
@@ -318,42 +346,130 @@ public:
     m_textureQuadProgram.render(m_textureQuad);
   }
 
+private:
+  /// Loads the BVH from the cache on another thread. The result tells whether the model is ready.
+  void startLoadingBvhCache()
+  {
+    m_rtMeshModelBuild = std::async(std::launch::async, [this]() {
+      return m_bvhCacheKey && m_rtMeshModel.loadCache(m_bvhCachePath.c_str(), m_bvhCacheKey);
+    });
+  }
+
+  /// Builds the BVH on another thread, once the cache turned out to be missing or stale and the whole model has been
+  /// read. The model is not touched by the render thread until the build is done.
+  void startBuildingRTMeshModel()
+  {
+    m_rtMeshModelBuild = std::async(std::launch::async, [this]() {
+      m_rtMeshModel.useObjModel(m_objMeshModel);
+
+      m_rtMeshModel.commit();
+
+      if (m_bvhCacheKey && !m_rtMeshModel.saveCache(m_bvhCachePath.c_str(), m_bvhCacheKey))
+        std::fprintf(stderr, "warning: failed to save BVH cache to '%s'\n", m_bvhCachePath.c_str());
+
+      return true;
+    });
+  }
+
+  /// Uploads the batches of triangles that were read since the last frame, and checks whether the model and its BVH
+  /// are ready.
+  void pollLoading(Ak::GLFWWindow& window)
+  {
+    for (const Ak::AsyncObjMeshLoader::Batch& batch : m_objMeshLoader.takeBatches())
+      m_meshBatch.addShape(batch.getShapeView());
+
+    if (m_objMeshLoader.takeModel(m_objMeshModel))
+      m_objMeshModelLoaded = true;
+
+    if (m_objMeshLoader.getState() == Ak::AsyncObjMeshLoader::State::failed) {
+
+      std::fprintf(stderr, "error: failed to load the model\n");
+
+      m_objMeshLoader.cancel();
+
+      glfwSetWindowShouldClose(window, GLFW_TRUE);
+    }
+
+    const bool buildDone =
+      m_rtMeshModelBuild.valid() && (m_rtMeshModelBuild.wait_for(std::chrono::seconds(0)) == std::future_status::ready);
+
+    if (buildDone)
+      m_rtMeshModelReady = m_rtMeshModelBuild.get();
+
+    if (!m_rtMeshModelReady && !m_rtMeshModelBuild.valid() && m_objMeshModelLoaded)
+      startBuildingRTMeshModel();
+  }
+
 private:
   Ak::FlyCamera<float> m_camera;
 
+  Ak::AsyncObjMeshLoader m_objMeshLoader;
+
   Ak::ObjMeshModel m_objMeshModel;
 
+  /// Whether the whole model has been read, as opposed to only some of its shapes.
+  bool m_objMeshModelLoaded = false;
+
+  std::string m_bvhCachePath;
+
+  std::uint64_t m_bvhCacheKey = 0;
+
   Ak::RTMeshModel<float> m_rtMeshModel;
 
+  bool m_rtMeshModelReady = false;
+
   Ak::OpenGLHRTMeshRenderProgram m_hrtMeshRenderProgram;
 
-  std::vector<OpenGLShape> m_openGLShapes;
+  /// Every shape of the model, drawn with one indirect draw call per frame.
+  Ak::OpenGLMeshBatch m_meshBatch;
+
+  /// Culls the shapes of the batch that are off screen or hidden behind the depth of the previous frame.
+  Ak::OpenGLMeshCullingPass m_cullingPass;
 
   std::shared_ptr<Framebuffer> m_framebuffer{ new Framebuffer() };
 
   Ak::OpenGLTextureQuadPair m_textureQuad{ &m_framebuffer->colorTexture };
 
   Ak::OpenGLTextureQuadPair::RenderProgram m_textureQuadProgram;
+
+  /// Declared last, so that it is destroyed first, which waits for the build to finish before the models go away.
+  std::future<bool> m_rtMeshModelBuild;
 };
 
+static bool
+isBinaryModelPath(const std::string& path)
+{
+  const std::size_t extension = path.rfind('.');
+
+  return (extension != std::string::npos) && (path.substr(extension) == ".akmesh");
+}
+
 static Ak::SingleWindowGLFWApp*
 makeApp(int argc, char** argv, Ak::GLFWWindow& window)
 {
   if (argc != 2) {
-    std::fprintf(stderr, "usage: %s <model.obj>\n", argv[0]);
+    std::fprintf(stderr, "usage: %s <model.obj | model.akmesh>\n", argv[0]);
     return nullptr;
   }
 
-  const char* objPath = argv[1];
+  const std::string modelPath = argv[1];
 
   Ak::ObjMeshModel objMeshModel;
 
-  if (!objMeshModel.loadFile(objPath)) {
-    std::fprintf(stderr, "%s: failed to load '%s'\n", argv[0], objPath);
+  // Binary models are only mapped into memory, so they are loaded right away. OBJ files are parsed in the background,
+  // so that the window shows up without waiting for them.
+
+  if (isBinaryModelPath(modelPath) && !objMeshModel.loadBinary(modelPath.c_str())) {
+    std::fprintf(stderr, "%s: failed to load '%s'\n", argv[0], modelPath.c_str());
     return nullptr;
   }
 
-  return new App(std::move(objMeshModel), window);
+  App* app = new App(std::move(objMeshModel), modelPath, window);
+
+  if (!isBinaryModelPath(modelPath))
+    app->loadInBackground(modelPath);
+
+  return app;
 }
 
 } // namespace
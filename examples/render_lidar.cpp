@@ -1,6 +1,7 @@
 #include <Ak/FlyCamera.h>
 #include <Ak/GLFW.h>
 #include <Ak/OpenGLLidarRenderProgram.h>
+#include <Ak/OpenGLStreamingVertexBuffer.h>
 #include <Ak/OpenGLVertexBuffer.h>
 #include <Ak/SingleWindowGLFWApp.h>
 
@@ -8,15 +9,27 @@
 
 #include <glm/gtc/matrix_transform.hpp>
 
+#include <algorithm>
 #include <fstream>
+#include <optional>
 #include <random>
 #include <vector>
 
+#include <cmath>
 #include <cstdio>
 #include <cstdlib>
+#include <cstring>
 
 namespace {
 
+using LidarVertex = Ak::OpenGLVertexBuffer<glm::vec3, float>::Vertex;
+
+/// The fraction of a revolution that is visible at once when replaying a scan as a live feed.
+constexpr float sweepFraction = 0.25f;
+
+/// The number of frames that it takes the simulated sensor to do one revolution.
+constexpr std::size_t framesPerRevolution = 240;
+
 class App final : public Ak::SingleWindowGLFWApp
 {
 public:
@@ -28,6 +41,19 @@ public:
     window.registerEventObserver(m_camera.makeGLFWEventProxy());
   }
 
+  /// Replays a scan as if it came from a spinning sensor, by rewriting a streaming buffer with the points of a
+  /// rotating sweep on each frame.
+  ///
+  /// @param replayPoints The points of the scan, sorted by azimuth.
+  App(std::vector<LidarVertex>&& replayPoints, Ak::GLFWWindow& window)
+    : m_streamingPoints(std::in_place, std::size_t(float(replayPoints.size()) * sweepFraction))
+    , m_replayPoints(std::move(replayPoints))
+  {
+    glClearColor(0, 0, 0, 1);
+
+    window.registerEventObserver(m_camera.makeGLFWEventProxy());
+  }
+
   const char* title() const noexcept override { return "LiDAR Renderer"; }
 
   void requestAnimationFrame(Ak::GLFWWindow& window) override
@@ -44,6 +70,19 @@ public:
 
     m_lidarRenderProgram.setMVP(mvp);
 
+    if (m_streamingPoints) {
+
+      writeSweep(*m_streamingPoints);
+
+      m_streamingPoints->bind();
+
+      m_lidarRenderProgram.render(*m_streamingPoints);
+
+      m_streamingPoints->unbind();
+
+      return;
+    }
+
     m_lidarPoints.bind();
 
     m_lidarRenderProgram.render(m_lidarPoints);
@@ -51,19 +90,55 @@ public:
     m_lidarPoints.unbind();
   }
 
+private:
+  void writeSweep(Ak::OpenGLStreamingVertexBuffer<glm::vec3, float>& streamingPoints)
+  {
+    const std::size_t pointCount = m_replayPoints.size();
+
+    if (!pointCount)
+      return;
+
+    const std::size_t sweepSize = std::size_t(float(pointCount) * sweepFraction);
+
+    const std::size_t sweepStart = ((m_frameIndex % framesPerRevolution) * pointCount) / framesPerRevolution;
+
+    LidarVertex* vertices = streamingPoints.beginWrite();
+
+    // The sweep may wrap around the end of the scan, in which case it is written in two parts.
+
+    const std::size_t firstPartSize = std::min(sweepSize, pointCount - sweepStart);
+
+    std::copy_n(m_replayPoints.begin() + std::ptrdiff_t(sweepStart), firstPartSize, vertices);
+
+    std::copy_n(m_replayPoints.begin(), sweepSize - firstPartSize, vertices + firstPartSize);
+
+    streamingPoints.endWrite(sweepSize);
+
+    m_frameIndex++;
+  }
+
 private:
   Ak::OpenGLLidarRenderProgram m_lidarRenderProgram;
 
   Ak::OpenGLVertexBuffer<glm::vec3, float> m_lidarPoints;
 
+  /// Only used when replaying a scan as a live feed.
+  std::optional<Ak::OpenGLStreamingVertexBuffer<glm::vec3, float>> m_streamingPoints;
+
+  std::vector<LidarVertex> m_replayPoints;
+
+  std::size_t m_frameIndex = 0;
+
   Ak::FlyCamera<float> m_camera;
 };
 
 static Ak::SingleWindowGLFWApp*
 makeApp(int argc, char** argv, Ak::GLFWWindow& window)
 {
-  if (argc != 2) {
-    std::fprintf(stderr, "usage: %s <lidar-points.txt>\n", argv[0]);
+  const bool streamFlag = (argc == 3) && (std::strcmp(argv[2], "--stream") == 0);
+
+  if ((argc != 2) && !streamFlag) {
+    std::fprintf(stderr, "usage: %s <lidar-points.txt> [--stream]\n", argv[0]);
     return nullptr;
   }
 
@@ -76,11 +151,11 @@ makeApp(int argc, char** argv, Ak::GLFWWindow& window)
     return nullptr;
   }
 
-  std::vector<Ak::OpenGLVertexBuffer<glm::vec3, float>::Vertex> points;
+  std::vector<LidarVertex> points;
 
   while (pointsFile) {
 
-    Ak::OpenGLVertexBuffer<glm::vec3, float>::Vertex vertex;
+    LidarVertex vertex;
 
     float x = 0;
     float y = 0;
@@ -102,6 +177,17 @@ makeApp(int argc, char** argv, Ak::GLFWWindow& window)
     points.emplace_back(vertex);
   }
 
+  if (streamFlag) {
+
+    auto getAzimuth = [](LidarVertex& vertex) { return std::atan2(vertex.attribAt<0>().x, -vertex.attribAt<0>().z); };
+
+    std::sort(points.begin(), points.end(), [&getAzimuth](LidarVertex& a, LidarVertex& b) {
+      return getAzimuth(a) < getAzimuth(b);
+    });
+
+    return new App(std::move(points), window);
+  }
+
   Ak::OpenGLVertexBuffer<glm::vec3, float> lidarPoints;
 
   lidarPoints.bind();
@@ -16,24 +16,37 @@
 
 namespace {
 
+using InstanceBuffer = Ak::OpenGLVertexBuffer<Ak::OpenGLPerInstance<glm::vec4>>;
+
+/// The distance between two instances of the point cloud, which spans 200 units on each axis.
+constexpr float instanceSpacing = 250.0f;
+
 class App final : public Ak::SingleWindowGLFWApp
 {
 public:
-  App(Ak::GLFWWindow& window)
+  /// @param instancesPerAxis The point cloud is drawn as a grid of instances with this many instances on each side, in
+  /// one draw call.
+  App(Ak::GLFWWindow& window, int instancesPerAxis)
+    : m_instanceCount(instancesPerAxis * instancesPerAxis)
   {
     glClearColor(0, 0, 0, 1);
 
     window.registerEventObserver(m_camera.makeGLFWEventProxy());
 
-    const std::vector<Ak::OpenGLVertexBuffer<glm::vec3, glm::vec4>::Vertex> points = generateRandomPoints(1'000'000);
+    // The instance buffer is filled on its own, before the point buffer is touched, so that nothing it does can end up
+    // in the vertex array of the point buffer. Attaching it then only adds its attributes to that vertex array.
 
-    m_pointBuffer.bind();
+    if (instancesPerAxis > 1)
+      fillInstanceGrid(instancesPerAxis);
+
+    const std::vector<Ak::OpenGLVertexBuffer<glm::vec3, glm::vec4>::Vertex> points = generateRandomPoints(1'000'000);
 
     m_pointBuffer.allocate(points.size(), GL_STATIC_DRAW);
 
     m_pointBuffer.write(0, &points[0], points.size());
 
-    m_pointBuffer.unbind();
+    if (instancesPerAxis > 1)
+      m_pointBuffer.attach(m_instanceBuffer);
   }
 
   const char* title() const noexcept override { return "Point Renderer"; }
@@ -54,7 +67,10 @@ public:
 
     m_pointRenderProgram.setMVP(mvp);
 
-    m_pointRenderProgram.render(m_pointBuffer);
+    if (m_instanceCount > 1)
+      m_pointRenderProgram.renderInstanced(m_pointBuffer, m_instanceCount);
+    else
+      m_pointRenderProgram.render(m_pointBuffer);
 
     m_pointBuffer.unbind();
 
@@ -62,6 +78,33 @@ public:
   }
 
 private:
+  void fillInstanceGrid(int instancesPerAxis)
+  {
+    std::vector<InstanceBuffer::Vertex> instances;
+
+    const float center = float(instancesPerAxis - 1) * 0.5f;
+
+    for (int z = 0; z < instancesPerAxis; z++) {
+
+      for (int x = 0; x < instancesPerAxis; x++) {
+
+        InstanceBuffer::Vertex instance;
+
+        const float offsetX = (float(x) - center) * instanceSpacing;
+
+        const float offsetZ = (float(z) - center) * instanceSpacing;
+
+        instance.attribAt<0>().value = glm::vec4(offsetX, 0.0f, offsetZ, 1.0f);
+
+        instances.emplace_back(instance);
+      }
+    }
+
+    m_instanceBuffer.allocate(instances.size(), GL_STATIC_DRAW);
+
+    m_instanceBuffer.write(0, &instances[0], instances.size());
+  }
+
   std::vector<Ak::OpenGLVertexBuffer<glm::vec3, glm::vec4>::Vertex> generateRandomPoints(size_t count)
   {
     std::seed_seq seed{ count, size_t(1234) };
@@ -89,13 +132,24 @@ private:
 
   Ak::OpenGLVertexBuffer<glm::vec3, glm::vec4> m_pointBuffer;
 
+  InstanceBuffer m_instanceBuffer;
+
+  GLsizei m_instanceCount = 1;
+
   Ak::FlyCamera<float> m_camera;
 };
 
 static Ak::SingleWindowGLFWApp*
-makeApp(int, char**, Ak::GLFWWindow& window)
+makeApp(int argc, char** argv, Ak::GLFWWindow& window)
 {
-  return new App(window);
+  const int instancesPerAxis = (argc > 1) ? std::atoi(argv[1]) : 1;
+
+  if ((argc > 2) || (instancesPerAxis < 1)) {
+    std::fprintf(stderr, "usage: %s [instances-per-axis]\n", argv[0]);
+    return nullptr;
+  }
+
+  return new App(window, instancesPerAxis);
 }
 
 } // namespace
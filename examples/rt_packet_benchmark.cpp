@@ -0,0 +1,342 @@
+#include <Ak/ObjMeshModel.h>
+#include <Ak/RTMeshModel.h>
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+using RTMeshModel = Ak::RTMeshModel<float>;
+
+using Ray = RTMeshModel::Ray;
+
+using Vec3 = RTMeshModel::Vec3;
+
+constexpr int imageWidth() { return 1024; }
+
+constexpr int imageHeight() { return 768; }
+
+constexpr int repeatCount() { return 5; }
+
+/// Generates the primary rays of a pinhole camera that looks at the mesh from the front. The rays are stored packet by
+/// packet, so that the rays of a square-ish tile of pixels are contiguous in memory.
+template<std::size_t LaneCount>
+std::vector<Ray>
+generatePrimaryRays(const Ak::ObjMeshModel& objMeshModel)
+{
+  float lo[3]{ std::numeric_limits<float>::max(), std::numeric_limits<float>::max(), std::numeric_limits<float>::max() };
+
+  float hi[3]{ -lo[0], -lo[1], -lo[2] };
+
+  for (const Ak::ObjMeshModel::ShapeView& shapeView : objMeshModel.getShapeViews()) {
+    for (std::size_t i = 0; i < shapeView.vertexCount; i++) {
+      const float p[3]{ shapeView.px(i), shapeView.py(i), shapeView.pz(i) };
+      for (int axis = 0; axis < 3; axis++) {
+        lo[axis] = std::min(lo[axis], p[axis]);
+        hi[axis] = std::max(hi[axis], p[axis]);
+      }
+    }
+  }
+
+  const float center[3]{ (lo[0] + hi[0]) * 0.5f, (lo[1] + hi[1]) * 0.5f, (lo[2] + hi[2]) * 0.5f };
+
+  const float radius = std::max(std::max(hi[0] - lo[0], hi[1] - lo[1]), hi[2] - lo[2]);
+
+  const Vec3 eye(center[0], center[1], center[2] + (radius * 1.5f));
+
+  const std::size_t tileWidth = (LaneCount >= 16) ? 4 : ((LaneCount >= 4) ? 2 : 1);
+
+  const std::size_t tileHeight = LaneCount / tileWidth;
+
+  const float aspectRatio = float(imageWidth()) / imageHeight();
+
+  std::vector<Ray> rays;
+
+  rays.reserve(imageWidth() * imageHeight());
+
+  for (std::size_t yTile = 0; yTile < std::size_t(imageHeight()); yTile += tileHeight) {
+
+    for (std::size_t xTile = 0; xTile < std::size_t(imageWidth()); xTile += tileWidth) {
+
+      for (std::size_t i = 0; i < LaneCount; i++) {
+
+        const std::size_t x = xTile + (i % tileWidth);
+        const std::size_t y = yTile + (i / tileWidth);
+
+        const float u = (((x + 0.5f) / imageWidth()) * 2.0f) - 1.0f;
+        const float v = (((y + 0.5f) / imageHeight()) * 2.0f) - 1.0f;
+
+        Vec3 dir(u * aspectRatio, v, -1.5f);
+
+        const float dirLength = std::sqrt((dir[0] * dir[0]) + (dir[1] * dir[1]) + (dir[2] * dir[2]));
+
+        dir = dir * (1.0f / dirLength);
+
+        rays.emplace_back(eye, dir, 0.0f, std::numeric_limits<float>::infinity());
+      }
+    }
+  }
+
+  return rays;
+}
+
+template<typename Func>
+double
+measureRaysPerSecond(std::size_t rayCount, Func func)
+{
+  double bestSeconds = std::numeric_limits<double>::max();
+
+  for (int i = 0; i < repeatCount(); i++) {
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    func();
+
+    const auto stop = std::chrono::high_resolution_clock::now();
+
+    bestSeconds = std::min(bestSeconds, std::chrono::duration<double>(stop - start).count());
+  }
+
+  return rayCount / bestSeconds;
+}
+
+template<typename Hit>
+std::size_t
+countHits(const std::vector<std::optional<Hit>>& hits)
+{
+  return std::size_t(std::count_if(hits.begin(), hits.end(), [](const std::optional<Hit>& hit) { return !!hit; }));
+}
+
+template<std::size_t LaneCount>
+void
+runBenchmark(const Ak::ObjMeshModel& objMeshModel, const RTMeshModel& rtMeshModel)
+{
+  const std::vector<Ray> rays = generatePrimaryRays<LaneCount>(objMeshModel);
+
+  const std::ptrdiff_t packetCount = std::ptrdiff_t(rays.size() / LaneCount);
+
+  std::vector<std::optional<RTMeshModel::ClosestHit>> closestHits(rays.size());
+
+  std::vector<std::optional<RTMeshModel::AnyHit>> anyHits(rays.size());
+
+  const double singleClosest = measureRaysPerSecond(
+    rays.size(), [&]() { rtMeshModel.findClosestHits(rays.data(), closestHits.data(), rays.size()); });
+
+  const std::size_t singleClosestHitCount = countHits(closestHits);
+
+  const double packetClosest = measureRaysPerSecond(rays.size(), [&]() {
+#pragma omp parallel for schedule(dynamic, 16)
+    for (std::ptrdiff_t i = 0; i < packetCount; i++)
+      rtMeshModel.findClosestHitPacket<LaneCount>(&rays[i * LaneCount], &closestHits[i * LaneCount]);
+  });
+
+  const std::size_t packetClosestHitCount = countHits(closestHits);
+
+  const double singleAny =
+    measureRaysPerSecond(rays.size(), [&]() { rtMeshModel.findAnyHits(rays.data(), anyHits.data(), rays.size()); });
+
+  const double packetAny = measureRaysPerSecond(rays.size(), [&]() {
+#pragma omp parallel for schedule(dynamic, 16)
+    for (std::ptrdiff_t i = 0; i < packetCount; i++)
+      rtMeshModel.findAnyHitPacket<LaneCount>(&rays[i * LaneCount], &anyHits[i * LaneCount]);
+  });
+
+  std::printf("%2zu lanes | closest: %8.2f -> %8.2f Mrays/s (%.2fx) | any: %8.2f -> %8.2f Mrays/s (%.2fx)\n",
+              LaneCount,
+              singleClosest * 1e-6,
+              packetClosest * 1e-6,
+              packetClosest / singleClosest,
+              singleAny * 1e-6,
+              packetAny * 1e-6,
+              packetAny / singleAny);
+
+  if (singleClosestHitCount != packetClosestHitCount)
+    std::fprintf(stderr,
+                 "warning: single ray traversal found %zu hits but packet traversal found %zu hits\n",
+                 singleClosestHitCount,
+                 packetClosestHitCount);
+}
+
+/// Compares the single ray throughput of a BVH of a given width to the one of the binary BVH.
+template<std::size_t Width>
+void
+runWideBenchmark(const Ak::ObjMeshModel& objMeshModel, const RTMeshModel& rtMeshModel)
+{
+  using WideRTMeshModel = Ak::RTMeshModel<float, Width>;
+
+  WideRTMeshModel wideRTMeshModel;
+
+  wideRTMeshModel.useObjModel(objMeshModel);
+
+  wideRTMeshModel.commit(WideRTMeshModel::BuildQuality::high);
+
+  const std::vector<Ray> rays = generatePrimaryRays<1>(objMeshModel);
+
+  std::vector<std::optional<RTMeshModel::ClosestHit>> closestHits(rays.size());
+
+  std::vector<std::optional<RTMeshModel::AnyHit>> anyHits(rays.size());
+
+  const double binaryClosest = measureRaysPerSecond(
+    rays.size(), [&]() { rtMeshModel.findClosestHits(rays.data(), closestHits.data(), rays.size()); });
+
+  const std::size_t binaryClosestHitCount = countHits(closestHits);
+
+  const double wideClosest = measureRaysPerSecond(
+    rays.size(), [&]() { wideRTMeshModel.findClosestHits(rays.data(), closestHits.data(), rays.size()); });
+
+  const std::size_t wideClosestHitCount = countHits(closestHits);
+
+  const double binaryAny =
+    measureRaysPerSecond(rays.size(), [&]() { rtMeshModel.findAnyHits(rays.data(), anyHits.data(), rays.size()); });
+
+  const double wideAny = measureRaysPerSecond(
+    rays.size(), [&]() { wideRTMeshModel.findAnyHits(rays.data(), anyHits.data(), rays.size()); });
+
+  std::printf("BVH%zu    | closest: %8.2f -> %8.2f Mrays/s (%.2fx) | any: %8.2f -> %8.2f Mrays/s (%.2fx)\n",
+              Width,
+              binaryClosest * 1e-6,
+              wideClosest * 1e-6,
+              wideClosest / binaryClosest,
+              binaryAny * 1e-6,
+              wideAny * 1e-6,
+              wideAny / binaryAny);
+
+  if (binaryClosestHitCount != wideClosestHitCount)
+    std::fprintf(stderr,
+                 "warning: binary BVH traversal found %zu hits but BVH%zu traversal found %zu hits\n",
+                 binaryClosestHitCount,
+                 Width,
+                 wideClosestHitCount);
+}
+
+void
+printMemoryReport(const char* name, const Ak::RTMeshModel<float, 8>::MemoryReport& report)
+{
+  std::printf("%-12s | %8.2f MiB total, %8.2f MiB of nodes | %6.2f bytes per triangle\n",
+              name,
+              report.getTotalBytes() / (1024.0 * 1024.0),
+              report.nodeBytes / (1024.0 * 1024.0),
+              report.getBytesPerTriangle());
+}
+
+/// Compares the memory usage and the single ray throughput of the quantized node formats to the full precision one.
+void
+runQuantizedBenchmark(const Ak::ObjMeshModel& objMeshModel)
+{
+  using WideRTMeshModel = Ak::RTMeshModel<float, 8>;
+
+  const WideRTMeshModel::NodeFormat nodeFormats[3]{ WideRTMeshModel::NodeFormat::full,
+                                                    WideRTMeshModel::NodeFormat::quantized16,
+                                                    WideRTMeshModel::NodeFormat::quantized8 };
+
+  const char* nodeFormatNames[3]{ "full", "quantized16", "quantized8" };
+
+  const std::vector<Ray> rays = generatePrimaryRays<1>(objMeshModel);
+
+  std::vector<std::optional<WideRTMeshModel::ClosestHit>> closestHits(rays.size());
+
+  for (int i = 0; i < 3; i++) {
+
+    WideRTMeshModel wideRTMeshModel;
+
+    wideRTMeshModel.setNodeFormat(nodeFormats[i]);
+
+    wideRTMeshModel.useObjModel(objMeshModel);
+
+    wideRTMeshModel.commit(WideRTMeshModel::BuildQuality::high);
+
+    printMemoryReport(nodeFormatNames[i], wideRTMeshModel.getMemoryReport());
+
+    const double closest = measureRaysPerSecond(
+      rays.size(), [&]() { wideRTMeshModel.findClosestHits(rays.data(), closestHits.data(), rays.size()); });
+
+    std::printf("%-12s | closest: %8.2f Mrays/s (%zu hits)\n", "", closest * 1e-6, countHits(closestHits));
+  }
+}
+
+/// Loads either an OBJ file or a binary mesh file written by the convert_mesh example, depending on the extension.
+bool
+loadModel(Ak::ObjMeshModel& objMeshModel, const std::string& path, bool indexed)
+{
+  const std::size_t extension = path.rfind('.');
+
+  const bool isBinary = (extension != std::string::npos) && (path.substr(extension) == ".akmesh");
+
+  return isBinary ? objMeshModel.loadBinary(path.c_str()) : objMeshModel.loadFile(path.c_str(), indexed);
+}
+
+} // namespace
+
+int
+main(int argc, char** argv)
+{
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s <model.obj | model.akmesh>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  const char* objPath = argv[1];
+
+  Ak::ObjMeshModel objMeshModel;
+
+  if (!loadModel(objMeshModel, objPath, true)) {
+    std::fprintf(stderr, "%s: failed to load '%s'\n", argv[0], objPath);
+    return EXIT_FAILURE;
+  }
+
+  RTMeshModel rtMeshModel;
+
+  rtMeshModel.useObjModel(objMeshModel);
+
+  // The last build is the one that is traced, so the highest quality goes last.
+
+  const RTMeshModel::BuildQuality buildQualities[3]{ RTMeshModel::BuildQuality::low,
+                                                     RTMeshModel::BuildQuality::medium,
+                                                     RTMeshModel::BuildQuality::high };
+
+  const char* buildQualityNames[3]{ "low (LBVH)", "medium (binned SAH)", "high (sweep SAH)" };
+
+  for (int i = 0; i < 3; i++) {
+
+    const auto start = std::chrono::high_resolution_clock::now();
+
+    rtMeshModel.commit(buildQualities[i]);
+
+    const auto stop = std::chrono::high_resolution_clock::now();
+
+    std::printf("BVH build, %-20s: %8.2f ms\n",
+                buildQualityNames[i],
+                std::chrono::duration<double, std::milli>(stop - start).count());
+  }
+
+  std::printf("Tracing %dx%d primary rays, best of %d runs (single ray -> packet).\n",
+              imageWidth(),
+              imageHeight(),
+              repeatCount());
+
+  runBenchmark<4>(objMeshModel, rtMeshModel);
+
+  runBenchmark<8>(objMeshModel, rtMeshModel);
+
+  runBenchmark<16>(objMeshModel, rtMeshModel);
+
+  std::printf("Tracing the same rays one at a time (binary BVH -> wide BVH).\n");
+
+  runWideBenchmark<4>(objMeshModel, rtMeshModel);
+
+  runWideBenchmark<8>(objMeshModel, rtMeshModel);
+
+  std::printf("Memory usage of the BVH8 node formats.\n");
+
+  runQuantizedBenchmark(objMeshModel);
+
+  return EXIT_SUCCESS;
+}
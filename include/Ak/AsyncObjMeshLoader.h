@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Ak/ObjMeshModel.h>
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <cstddef>
+
+namespace Ak {
+
+/// Loads an OBJ file on a worker thread, so that an application can keep presenting frames while a large model is
+/// loading. The triangles are handed out in batches as the file is read, so that they can be uploaded to the GPU and
+/// drawn before the rest of the file is read, and the whole model is handed out once the file has been read.
+///
+/// The loader is polled rather than calling back, since the batches usually have to be uploaded on the thread that
+/// owns the OpenGL context.
+class AsyncObjMeshLoader final
+{
+public:
+  /// A batch of triangles, with the same vertex layout as @ref ObjMeshModel::ShapeView.
+  struct Batch final
+  {
+    /// The id of the material of the triangles, as reported by @ref ObjMeshModel::streamFile.
+    int materialId = -1;
+
+    ObjMeshModel::Material material;
+
+    /// The vertices of the triangles. The worker keeps a reference to them until it puts the whole model together, so
+    /// that the triangles are held once however many batches are waiting to be taken. Releasing a batch once it has
+    /// been uploaded lets the worker free its vertices as soon as they are copied into the model.
+    std::shared_ptr<const std::vector<float>> vertices;
+
+    ObjMeshModel::ShapeView getShapeView() const noexcept
+    {
+      ObjMeshModel::ShapeView shapeView{ vertices->data(), vertices->size() / 8 };
+
+      shapeView.material = &material;
+
+      return shapeView;
+    }
+  };
+
+  enum class State
+  {
+    idle,
+    loading,
+    finished,
+    failed
+  };
+
+  AsyncObjMeshLoader() = default;
+
+  AsyncObjMeshLoader(const AsyncObjMeshLoader&) = delete;
+
+  /// Cancels the load, if one is still in progress.
+  ~AsyncObjMeshLoader();
+
+  /// Starts loading a file on the worker thread. A load that is still in progress is cancelled first.
+  ///
+  /// @param path The path of the OBJ file to load.
+  ///
+  /// @param batchBudget The memory budget given to @ref ObjMeshModel::streamFile, which bounds the size of a batch.
+  void start(const char* path, std::size_t batchBudget = 16 * 1024 * 1024);
+
+  /// Stops the worker thread as soon as possible and waits for it. The batches and model are discarded.
+  void cancel();
+
+  State getState() const noexcept { return m_state; }
+
+  /// Takes the batches that were read since the last call, without waiting for the worker.
+  ///
+  /// @note The batches are queued until they are taken, so this should be called regularly (once per frame, for
+  /// example) to keep the memory use of the queue low.
+  std::vector<Batch> takeBatches();
+
+  /// Takes the whole model once the load has finished. Its shapes are the same as the ones from a call to @ref
+  /// ObjMeshModel::loadFile in non-indexed mode, so data derived from either one can be shared.
+  ///
+  /// @return True if the model was taken, false if the load has not finished, failed, or the model was already taken.
+  bool takeModel(ObjMeshModel& objMeshModel);
+
+private:
+  void load(std::string path, std::size_t batchBudget);
+
+private:
+  std::thread m_thread;
+
+  std::atomic<State> m_state{ State::idle };
+
+  std::atomic<bool> m_cancelFlag{ false };
+
+  /// Guards the queue of batches and the finished model, which are shared with the worker.
+  std::mutex m_mutex;
+
+  std::vector<Batch> m_batches;
+
+  ObjMeshModel m_objMeshModel;
+
+  bool m_modelTaken = false;
+};
+
+} // namespace Ak
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Ak {
+
+/// A read-only view of a file that is mapped into memory. The pages of the file are loaded by the operating system as
+/// they are accessed, so opening a large file is cheap and its contents can be shared between processes.
+class MappedFile final
+{
+public:
+  MappedFile() = default;
+
+  MappedFile(MappedFile&&);
+
+  MappedFile(const MappedFile&) = delete;
+
+  MappedFile& operator=(MappedFile&&);
+
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile();
+
+  /// Maps a file into memory. If another file was mapped, it is unmapped first.
+  ///
+  /// @param path The path of the file to map.
+  ///
+  /// @return True on success, false on failure.
+  bool open(const char* path);
+
+  void close();
+
+  bool isOpen() const noexcept { return m_data != nullptr; }
+
+  const void* data() const noexcept { return m_data; }
+
+  std::size_t size() const noexcept { return m_size; }
+
+private:
+  void* m_data = nullptr;
+
+  std::size_t m_size = 0;
+
+#ifdef _WIN32
+  void* m_fileHandle = nullptr;
+
+  void* m_mappingHandle = nullptr;
+#endif
+};
+
+/// Computes a value that changes whenever a file is modified, from its path, size and time of last modification,
+/// without reading its contents. This is meant as the key of data derived from the file and cached on disk, such as
+/// with @ref RTMeshModel::saveCache, so that a warm cache is found without parsing the file.
+///
+/// @return The key, or zero if the file could not be found.
+std::uint64_t computeFileVersionKey(const char* path);
+
+} // namespace Ak
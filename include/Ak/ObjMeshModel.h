@@ -1,8 +1,13 @@
 #pragma once
 
+#include <Ak/PackedVertexAttribs.h>
+
+#include <functional>
+#include <string>
 #include <vector>
 
 #include <cstddef>
+#include <cstdint>
 
 namespace Ak {
 
@@ -11,12 +16,55 @@ class ObjMeshModelImpl;
 class ObjMeshModel final
 {
 public:
+  /// Contains the supported (not all) attributes of an OBJ material.
+  ///
+  /// The texture paths are resolved against the directory of the material library (MTL file) that defines them, so they
+  /// can be opened as they are. A path is empty if the material does not use that texture.
+  struct Material final
+  {
+    std::string name;
+
+    float albedo[3]{ 0.8f, 0.8f, 0.8f };
+
+    float emission[3]{ 0, 0, 0 };
+
+    /// The diffuse texture (map_Kd).
+    std::string albedoTexture;
+
+    /// The emissive texture (map_Ke).
+    std::string emissionTexture;
+
+    /// The normal or bump map (norm, bump or map_bump).
+    std::string normalTexture;
+  };
+
   struct ShapeView final
   {
     const float* vertexBuffer = nullptr;
 
     std::size_t vertexCount = 0;
 
+    /// The vertex of each corner of each triangle, if the model was loaded in indexed mode. Otherwise this is null and
+    /// every three consecutive vertices make a triangle.
+    const std::uint32_t* indexBuffer = nullptr;
+
+    std::size_t indexCount = 0;
+
+    /// The material of the shape, which belongs to the model. Shapes without a material in the OBJ file get a default
+    /// material, so this is only null for shape views that were made by hand.
+    const Material* material = nullptr;
+
+    constexpr bool isIndexed() const noexcept { return indexBuffer != nullptr; }
+
+    constexpr std::size_t triangleCount() const noexcept { return (isIndexed() ? indexCount : vertexCount) / 3; }
+
+    /// Gets the index of the vertex at a corner of a triangle, where corner @p 3t + c is the corner @p c of triangle
+    /// @p t. This works the same way whether the model is indexed or not.
+    constexpr std::size_t vertexIndex(size_t cornerIndex) const noexcept
+    {
+      return isIndexed() ? indexBuffer[cornerIndex] : cornerIndex;
+    }
+
     constexpr float px(size_t vertexIndex) const noexcept { return vertexBuffer[(vertexIndex * 8) + 0]; }
     constexpr float py(size_t vertexIndex) const noexcept { return vertexBuffer[(vertexIndex * 8) + 1]; }
     constexpr float pz(size_t vertexIndex) const noexcept { return vertexBuffer[(vertexIndex * 8) + 2]; }
@@ -29,16 +77,165 @@ public:
     constexpr float ty(size_t vertexIndex) const noexcept { return vertexBuffer[(vertexIndex * 8) + 7]; }
   };
 
+  /// A vertex compressed to 16 bytes, which is half the size of the vertices of a shape view. The attributes are laid
+  /// out the same way as the vertices of an OpenGLVertexBuffer<PackedPosition, PackedNormal, PackedTexCoords>.
+  struct PackedVertex final
+  {
+    PackedPosition position;
+
+    PackedNormal normal;
+
+    PackedTexCoords texCoords;
+  };
+
+  /// A shape with compressed vertices, meant for drawing large models with less memory and bandwidth.
+  struct PackedShape final
+  {
+    std::vector<PackedVertex> vertices;
+
+    /// The same indices as the shape that was packed, if it was indexed.
+    std::vector<std::uint32_t> indices;
+
+    /// The positions are decoded as `positionOffset + (position * positionScale)`, where each component of `position`
+    /// is in [0, 1]. This is the bounding box of the shape (or its bounding cube, if packed with a uniform scale), so
+    /// the precision is 1/65535 of its size on each axis.
+    float positionOffset[3]{ 0, 0, 0 };
+
+    float positionScale[3]{ 0, 0, 0 };
+
+    const Material* material = nullptr;
+  };
+
+  /// An axis-aligned bounding box.
+  struct Bounds final
+  {
+    float min[3]{ 0, 0, 0 };
+
+    float max[3]{ 0, 0, 0 };
+  };
+
+  /// How well the triangles of a shape reuse the vertices that a GPU has already transformed, simulated with a FIFO
+  /// cache of transformed vertices.
+  struct VertexCacheStats final
+  {
+    /// The average cache miss ratio, which is the number of vertex shader invocations per triangle. This is 3 at worst,
+    /// and around 0.6 to 0.7 for a well ordered mesh.
+    float acmr = 0;
+
+    /// The average transformed vertex ratio, which is the number of vertex shader invocations per vertex. This is 1 at
+    /// best, when each vertex is transformed once.
+    float atvr = 0;
+  };
+
+  /// Receives the triangles read by @ref ObjMeshModel::streamFile. The shape view is not indexed and, along with its
+  /// material, is only valid until the callback returns. The material id is the index of the material in the material
+  /// libraries of the file, or -1 if the triangles have no material. Returning false stops the stream.
+  using StreamCallback = std::function<bool(const ShapeView& shapeView, int materialId)>;
+
   ObjMeshModel();
 
   ObjMeshModel(ObjMeshModel&&);
 
+  ObjMeshModel& operator=(ObjMeshModel&&);
+
   ~ObjMeshModel();
 
-  bool loadFile(const char* path);
+  /// Loads the shapes of an OBJ file into the model. The shapes of a file loaded with @ref ObjMeshModel::loadBinary
+  /// are dropped, while the shapes of other OBJ files are kept.
+  ///
+  /// @param path The path of the file to load.
+  ///
+  /// @param indexed If true, the corners of the faces that refer to the same position, normal and texture coordinates
+  /// share a single vertex, and the shapes get an index buffer. This usually makes the vertex buffers several times
+  /// smaller. If false, each corner gets its own vertex and the shapes have no index buffer.
+  ///
+  /// @return True on success, false on failure.
+  bool loadFile(const char* path, bool indexed = false);
+
+  /// Reads the triangles of an OBJ file in batches and hands them to a callback, instead of keeping them in a model.
+  /// This makes it possible to load files whose triangles do not fit in memory, for example by writing each batch to a
+  /// vertex buffer as it arrives. The triangles are reported in file order, with consecutive triangles of the same
+  /// material grouped together, which gives the same triangles as @ref ObjMeshModel::loadFile once they are sorted by
+  /// material.
+  ///
+  /// @param path The path of the file to read.
+  ///
+  /// @param memoryBudget The approximate number of bytes that the text being parsed and the batches of triangles may
+  /// take at once. The positions, normals and texture coordinates of the file are kept until the end on top of this,
+  /// since any face may refer to any vertex before it, but they are usually much smaller than the triangles.
+  ///
+  /// @param callback The function that receives each batch of triangles.
+  ///
+  /// @return True on success, false if the file could not be read or the callback stopped the stream.
+  static bool streamFile(const char* path, std::size_t memoryBudget, const StreamCallback& callback);
+
+  /// Saves the shapes of the model to a binary file, which can be loaded back much faster than the original OBJ file.
+  /// The vertex and index buffers of each shape are stored as they are in memory, each one aligned to 64 bytes. The
+  /// materials are stored along with the shapes, with their texture paths made relative to the directory of the binary
+  /// file, so that the file and its textures can be moved together.
+  ///
+  /// @param path The path of the file to save to.
+  ///
+  /// @return True on success, false on failure.
+  bool saveBinary(const char* path) const;
+
+  /// Loads a binary file written by @ref ObjMeshModel::saveBinary, replacing the shapes of the model. The file is
+  /// mapped into memory and the shape views point straight into the mapping, so nothing is copied, and processes that
+  /// load the same file share its memory. The file stays mapped until the model is destroyed or loads another file.
+  ///
+  /// @param path The path of the file to load.
+  ///
+  /// @return True on success, false if the file could not be opened or was not written by a compatible build.
+  bool loadBinary(const char* path);
+
+  /// Reorders the triangles of the indexed shapes so that they reuse the vertices in the GPU vertex cache as much as
+  /// possible, using Tom Forsyth's linear speed algorithm, then reorders their vertices in the order the triangles
+  /// first use them, so that vertices are fetched from memory mostly in sequence. The mesh itself does not change.
+  ///
+  /// @note Shapes that are not indexed, and shapes loaded with @ref ObjMeshModel::loadBinary, are left as they are.
+  void optimizeVertexCache();
+
+  /// Simulates the vertex cache of a GPU drawing a shape.
+  ///
+  /// @param shapeView The shape to analyze, which may come from any model.
+  ///
+  /// @param cacheSize The number of vertices in the simulated cache.
+  static VertexCacheStats analyzeVertexCache(const ShapeView& shapeView, std::size_t cacheSize = 16);
+
+  /// Computes the bounding box of the vertices of a shape, which is all zeros for a shape without vertices.
+  static Bounds computeBounds(const ShapeView& shapeView);
+
+  /// Compresses the vertices of a shape. The normals lose some precision (about a tenth of a degree) and so do the
+  /// texture coordinates (11 significant bits), which is invisible in most renderings.
+  ///
+  /// @param shapeView The shape to compress, which may come from any model.
+  ///
+  /// @param uniformScale Whether to pack the positions within the bounding cube of the shape instead of its bounding
+  /// box, so that the scale is the same on every axis. The positions can then be decoded with an offset and a single
+  /// scale, such as a per-instance attribute, at the cost of some precision on the shorter axes.
+  static PackedShape packShape(const ShapeView& shapeView, bool uniformScale = false);
+
+  /// Adds a shape to the model, made of a copy of the vertices, indices and material of a shape view. This is meant for
+  /// models that are put together from several sources, such as the batches of @ref ObjMeshModel::streamFile.
+  void addShape(const ShapeView& shapeView);
+
+  /// Adds a shape that is not indexed, and whose vertices are written by the caller afterwards. This avoids the copy of
+  /// @ref ObjMeshModel::addShape for a shape that is put together from several pieces, which can be written straight
+  /// into the model and released one at a time.
+  ///
+  /// @param vertexCount The number of vertices of the shape, which has three per triangle.
+  ///
+  /// @return The vertex buffer of the shape, with the same layout as @ref ObjMeshModel::ShapeView::vertexBuffer. It
+  /// stays valid until the shapes of the model are replaced.
+  float* addShape(const Material& material, std::size_t vertexCount);
 
   std::vector<ShapeView> getShapeViews() const;
 
+  /// Computes a hash of the vertex data of all the shapes in the model. This can be used as a key for data that is
+  /// derived from the model and saved to disk, such as a BVH. It reads every vertex, so a model that comes from a file
+  /// is better keyed with @ref computeFileVersionKey, which is known before the file is parsed.
+  std::uint64_t computeHash() const;
+
 private:
   ObjMeshModelImpl* m_impl;
 };
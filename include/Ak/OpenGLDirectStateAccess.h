@@ -0,0 +1,95 @@
+#pragma once
+
+#include <glad/glad.h>
+
+namespace Ak {
+
+/// Indicates if the context has direct state access (OpenGL 4.5), in which case the wrappers create and edit objects
+/// by name instead of binding them first. It is decided at run time from the version that glad loaded, so the same
+/// build runs on OpenGL 4.3 contexts too.
+inline bool
+isDirectStateAccessAvailable() noexcept
+{
+  return GLAD_GL_VERSION_4_5 != 0;
+}
+
+/// Binds an object for the duration of an edit that goes through a bind point, unless the object is already bound,
+/// which is what the wrappers fall back to without direct state access.
+template<typename Object>
+class OpenGLScopedBind final
+{
+public:
+  explicit OpenGLScopedBind(Object& object)
+    : m_object(object.isBound() ? nullptr : &object)
+  {
+    if (m_object)
+      m_object->bind();
+  }
+
+  OpenGLScopedBind(const OpenGLScopedBind&) = delete;
+
+  ~OpenGLScopedBind()
+  {
+    if (m_object)
+      m_object->unbind();
+  }
+
+private:
+  Object* m_object;
+};
+
+/// Resizes the storage of a buffer object while keeping the start of its contents, without reading them back to the
+/// CPU. The contents go through a temporary buffer on the GPU, so that the buffer keeps its name, and the vertex
+/// arrays that read from it stay valid.
+///
+/// @param keptByteCount The number of bytes at the start of the buffer to keep, which must fit in the new size.
+///
+/// @param byteCount The new size of the buffer, in bytes.
+inline void
+resizeBufferKeepingContents(GLuint buffer, GLsizeiptr keptByteCount, GLsizeiptr byteCount, GLenum usage)
+{
+  GLuint temporary = 0;
+
+  if (isDirectStateAccessAvailable()) {
+
+    if (keptByteCount > 0) {
+      glCreateBuffers(1, &temporary);
+      glNamedBufferData(temporary, keptByteCount, nullptr, GL_STREAM_COPY);
+      glCopyNamedBufferSubData(buffer, temporary, 0, 0, keptByteCount);
+    }
+
+    glNamedBufferData(buffer, byteCount, nullptr, usage);
+
+    if (keptByteCount > 0) {
+      glCopyNamedBufferSubData(temporary, buffer, 0, 0, keptByteCount);
+      glDeleteBuffers(1, &temporary);
+    }
+
+    return;
+  }
+
+  // The copy binding points are used, so that no binding that belongs to a vertex array is changed.
+
+  if (keptByteCount > 0) {
+    glGenBuffers(1, &temporary);
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, temporary);
+    glBufferData(GL_COPY_WRITE_BUFFER, keptByteCount, nullptr, GL_STREAM_COPY);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keptByteCount);
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+  glBufferData(GL_COPY_WRITE_BUFFER, byteCount, nullptr, usage);
+
+  if (keptByteCount > 0) {
+    glBindBuffer(GL_COPY_READ_BUFFER, temporary);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, keptByteCount);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glDeleteBuffers(1, &temporary);
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+} // namespace Ak
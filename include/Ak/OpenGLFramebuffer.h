@@ -9,6 +9,8 @@ namespace Ak {
 class OpenGLRenderbuffer;
 class OpenGLTexture2D;
 
+/// A framebuffer. Attachments are made by name with direct state access, and otherwise by binding the framebuffer
+/// for the duration of the call if it is not bound already, so it only has to be bound to be rendered to.
 class OpenGLFramebuffer
 {
 public:
@@ -20,20 +22,18 @@ public:
 
   bool isBound() const noexcept { return m_boundFlag; }
 
-  /// @note The framebuffer must be bound before calling this function.
   bool isComplete() const;
 
   void bind();
 
   void unbind();
 
-  /// @note The framebuffer must be bound before calling this function.
+  /// Attaches a renderbuffer as the depth attachment.
   void attach(OpenGLRenderbuffer&);
 
-  /// @note The framebuffer must be bound before calling this function.
   void attach(OpenGLTexture2D& colorAttachment);
 
-  /// @note The framebuffer must be bound before calling this function.
+  /// Attaches up to eight color textures, which become the draw buffers in the order they are given.
   void attach(const std::vector<OpenGLTexture2D*>& colorAttachments);
 
 private:
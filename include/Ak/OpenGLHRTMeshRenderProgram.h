@@ -4,14 +4,23 @@
 #include <Ak/OpenGLRenderbuffer.h>
 #include <Ak/OpenGLShaderProgram.h>
 #include <Ak/OpenGLTexture2D.h>
+#include <Ak/PackedVertexAttribs.h>
 
 #include <glm/fwd.hpp>
 
+#include <cassert>
+#include <cstddef>
+
 namespace Ak {
 
 template<typename... Attribs>
 class OpenGLVertexBuffer;
 
+template<typename Index>
+class OpenGLIndexBuffer;
+
+class OpenGLMeshBatch;
+
 /// This program is used to render a triangle mesh onto a set of textures suitable for hydrid rasterization and ray
 /// tracing. It produces the following data:
 ///
@@ -32,16 +41,103 @@ public:
 
   void setMVP(const glm::mat4& mvp);
 
+  /// Clears the textures that the meshes are rendered to. The render functions add to what was rendered before, so this
+  /// is called once per frame, before rendering the meshes of the frame. The depth in the normal/depth texture is
+  /// cleared to the far plane (1 in normalized device coordinates).
+  void clear();
+
+  /// Sets a transform that is applied to the positions before the instance transform, such as the one that maps packed
+  /// positions to the bounding box of their shape. Without instancing, it can also be folded into the MVP matrix.
+  void setPositionTransform(const glm::mat4& positionTransform);
+
   void render(const OpenGLVertexBuffer<glm::vec3, glm::vec3, glm::vec2>& vertexBuffer);
 
+  /// Renders a range of the vertices in a buffer, so that several meshes can share one buffer.
+  void render(const OpenGLVertexBuffer<glm::vec3, glm::vec3, glm::vec2>& vertexBuffer,
+              GLint firstVertex,
+              GLsizei vertexCount);
+
+  /// Renders a mesh with packed vertices, such as the ones made by @ref ObjMeshModel::packShape.
+  ///
+  /// @note The bounding box of the positions must be folded into the matrix given to @ref
+  /// OpenGLHRTMeshRenderProgram::setMVP, since the positions are in [0, 1].
+  void render(const OpenGLVertexBuffer<PackedPosition, PackedNormal, PackedTexCoords>& vertexBuffer);
+
+  void render(const OpenGLVertexBuffer<PackedPosition, PackedNormal, PackedTexCoords>& vertexBuffer,
+              GLint firstVertex,
+              GLsizei vertexCount);
+
+  /// Renders an indexed mesh, with either vertex layout.
+  ///
+  /// @note The index buffer must be attached to the vertex buffer, and the vertex buffer must be bound.
+  template<typename... Attribs, typename Index>
+  void render(const OpenGLVertexBuffer<Attribs...>& vertexBuffer, const OpenGLIndexBuffer<Index>& indexBuffer)
+  {
+    render(vertexBuffer, indexBuffer, 0, indexBuffer.getIndexCount());
+  }
+
+  /// Renders a range of the triangles of an indexed mesh.
+  ///
+  /// @param firstIndex The position of the first index of the range, which is a multiple of three.
+  ///
+  /// @param indexCount The number of indices in the range, which is three per triangle.
+  template<typename... Attribs, typename Index>
+  void render(const OpenGLVertexBuffer<Attribs...>& vertexBuffer,
+              const OpenGLIndexBuffer<Index>& indexBuffer,
+              size_t firstIndex,
+              size_t indexCount)
+  {
+    assert(vertexBuffer.isBound());
+
+    assert((firstIndex + indexCount) <= indexBuffer.getIndexCount());
+
+    renderIndexedTriangles(indexBuffer.getIndexType(), firstIndex * sizeof(Index), GLsizei(indexCount), 1);
+  }
+
+  /// Renders several instances of a mesh in one draw call.
+  ///
+  /// The vertex buffer must have a buffer of per-instance attributes attached to it, with the translation and uniform
+  /// scale of each instance as its first attribute (a vec4) and optionally the rotation of each instance as a unit
+  /// quaternion (another vec4), for example an `OpenGLVertexBuffer<OpenGLPerInstance<glm::vec4>,
+  /// OpenGLPerInstance<glm::vec4>>`.
+  template<typename... Attribs>
+  void renderInstanced(const OpenGLVertexBuffer<Attribs...>& vertexBuffer, GLsizei instanceCount)
+  {
+    assert(vertexBuffer.isBound());
+
+    renderTriangles(0, GLsizei(vertexBuffer.getVertexCount()), instanceCount);
+  }
+
+  /// Renders several instances of an indexed mesh in one draw call.
+  template<typename... Attribs, typename Index>
+  void renderInstanced(const OpenGLVertexBuffer<Attribs...>& vertexBuffer,
+                       const OpenGLIndexBuffer<Index>& indexBuffer,
+                       GLsizei instanceCount)
+  {
+    assert(vertexBuffer.isBound());
+
+    renderIndexedTriangles(indexBuffer.getIndexType(), 0, GLsizei(indexBuffer.getIndexCount()), instanceCount);
+  }
+
+  /// Renders every shape of a batch with one indirect draw call.
+  ///
+  /// @note The batch must be bound, and the position transform should be left as the identity.
+  void render(const OpenGLMeshBatch& meshBatch);
+
   void resizeFramebuffer(int w, int h);
 
   OpenGLTexture2D* albedoTexture() { return &m_albedoTexture; }
 
   OpenGLTexture2D* normalDepthTexture() { return &m_normalDepthTexture; }
 
+private:
+  void renderTriangles(GLint firstVertex, GLsizei vertexCount, GLsizei instanceCount = 1);
+
+  void renderIndexedTriangles(GLenum indexType, size_t indexByteOffset, GLsizei indexCount, GLsizei instanceCount);
+
 private:
   GLint m_mvpLocation = -1;
+  GLint m_positionTransformLocation = -1;
   OpenGLFramebuffer m_framebuffer;
   OpenGLRenderbuffer m_renderbuffer;
   OpenGLTexture2D m_albedoTexture;
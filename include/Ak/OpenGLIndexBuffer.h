@@ -0,0 +1,195 @@
+#pragma once
+
+#include <Ak/OpenGLDirectStateAccess.h>
+
+#include <glad/glad.h>
+
+#include <algorithm>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace Ak {
+
+template<typename... Attribs>
+class OpenGLVertexBuffer;
+
+template<typename Index>
+struct OpenGLIndexTraits final
+{};
+
+template<>
+struct OpenGLIndexTraits<std::uint16_t> final
+{
+  static constexpr GLenum type() { return GL_UNSIGNED_SHORT; }
+};
+
+template<>
+struct OpenGLIndexTraits<std::uint32_t> final
+{
+  static constexpr GLenum type() { return GL_UNSIGNED_INT; }
+};
+
+/// A buffer of vertex indices, for drawing meshes whose vertices are shared between triangles. 16-bit indices take half
+/// the memory, and can be used for meshes with up to 65536 vertices.
+///
+/// The index buffer of a draw call is part of the vertex array object, so an index buffer is drawn by attaching it to
+/// an @ref OpenGLVertexBuffer, after which binding the vertex buffer is enough for indexed draw calls.
+template<typename Index>
+class OpenGLIndexBuffer final
+{
+public:
+  OpenGLIndexBuffer();
+
+  OpenGLIndexBuffer(OpenGLIndexBuffer&&);
+
+  OpenGLIndexBuffer(const OpenGLIndexBuffer&) = delete;
+
+  ~OpenGLIndexBuffer();
+
+  /// Makes this the index buffer of a vertex buffer, until another index buffer is attached to it. The vertex buffer
+  /// does not have to be bound.
+  template<typename... Attribs>
+  void attach(OpenGLVertexBuffer<Attribs...>& vertexBuffer);
+
+  /// Resizes the buffer to fit a given number of indices. The buffer is empty afterwards, until indices are written to
+  /// it.
+  ///
+  /// @note The buffer does not have to be attached or bound, so that it can be filled before or after it is attached.
+  void allocate(size_t indexCount, GLenum usage);
+
+  /// Resizes the buffer to fit a given number of indices, keeping the indices in use, which are copied on the GPU.
+  ///
+  /// @param indexCount The number of indices to allocate room for, which must be at least the number in use.
+  void reserve(size_t indexCount, GLenum usage);
+
+  /// @note Must be allocated with @ref OpenGLIndexBuffer::allocate before calling this function.
+  ///
+  /// @param offset The position of the first index to write.
+  ///
+  /// @param indices The indices to write to the buffer.
+  ///
+  /// @param indexCount The number of indices to write to the buffer.
+  void write(size_t offset, const Index* indices, size_t indexCount);
+
+  /// Gets the number of indices in use, which is the end of the furthest range written since the last allocation.
+  size_t getIndexCount() const noexcept { return m_indexCount; }
+
+  size_t getIndexCapacity() const noexcept { return m_indexCapacity; }
+
+  /// Gets the type to pass to the draw calls.
+  static constexpr GLenum getIndexType() { return OpenGLIndexTraits<Index>::type(); }
+
+private:
+  GLuint m_indexBuffer = 0;
+
+  size_t m_indexCapacity = 0;
+
+  size_t m_indexCount = 0;
+};
+
+template<typename Index>
+OpenGLIndexBuffer<Index>::OpenGLIndexBuffer()
+{
+  if (isDirectStateAccessAvailable())
+    glCreateBuffers(1, &m_indexBuffer);
+  else
+    glGenBuffers(1, &m_indexBuffer);
+}
+
+template<typename Index>
+OpenGLIndexBuffer<Index>::OpenGLIndexBuffer(OpenGLIndexBuffer<Index>&& other)
+  : m_indexBuffer(other.m_indexBuffer)
+  , m_indexCapacity(other.m_indexCapacity)
+  , m_indexCount(other.m_indexCount)
+{
+  other.m_indexBuffer = 0;
+  other.m_indexCapacity = 0;
+  other.m_indexCount = 0;
+}
+
+template<typename Index>
+OpenGLIndexBuffer<Index>::~OpenGLIndexBuffer()
+{
+  // A vertex array object that the buffer is attached to keeps it alive until it is deleted too.
+  if (m_indexBuffer)
+    glDeleteBuffers(1, &m_indexBuffer);
+}
+
+template<typename Index>
+template<typename... Attribs>
+void
+OpenGLIndexBuffer<Index>::attach(OpenGLVertexBuffer<Attribs...>& vertexBuffer)
+{
+  if (isDirectStateAccessAvailable()) {
+    glVertexArrayElementBuffer(vertexBuffer.m_vertexArrayObject, m_indexBuffer);
+    return;
+  }
+
+  OpenGLScopedBind<OpenGLVertexBuffer<Attribs...>> scopedBind(vertexBuffer);
+
+  glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_indexBuffer);
+}
+
+template<typename Index>
+void
+OpenGLIndexBuffer<Index>::allocate(size_t indexCount, GLenum usage)
+{
+  const GLsizeiptr byteCount = GLsizeiptr(indexCount * sizeof(Index));
+
+  if (isDirectStateAccessAvailable()) {
+    glNamedBufferData(m_indexBuffer, byteCount, nullptr, usage);
+  } else {
+    // The element array binding belongs to the bound vertex array object, so the data is uploaded through another
+    // binding point to leave it alone.
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+
+    glBufferData(GL_COPY_WRITE_BUFFER, byteCount, nullptr, usage);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  m_indexCapacity = indexCount;
+
+  m_indexCount = 0;
+}
+
+template<typename Index>
+void
+OpenGLIndexBuffer<Index>::reserve(size_t indexCount, GLenum usage)
+{
+  assert(indexCount >= m_indexCount);
+
+  const GLsizeiptr keptSize = GLsizeiptr(m_indexCount * sizeof(Index));
+
+  resizeBufferKeepingContents(m_indexBuffer, keptSize, GLsizeiptr(indexCount * sizeof(Index)), usage);
+
+  m_indexCapacity = indexCount;
+}
+
+template<typename Index>
+void
+OpenGLIndexBuffer<Index>::write(size_t offset, const Index* indices, size_t indexCount)
+{
+  assert((offset + indexCount) <= m_indexCapacity);
+
+  const size_t byteOffset = sizeof(Index) * offset;
+
+  const size_t byteCount = sizeof(Index) * indexCount;
+
+  if (isDirectStateAccessAvailable()) {
+    glNamedBufferSubData(m_indexBuffer, GLintptr(byteOffset), GLsizeiptr(byteCount), indices);
+  } else {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_indexBuffer);
+
+    glBufferSubData(GL_COPY_WRITE_BUFFER, GLintptr(byteOffset), GLsizeiptr(byteCount), indices);
+
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  m_indexCount = std::max(m_indexCount, offset + indexCount);
+}
+
+} // namespace Ak
@@ -13,6 +13,9 @@ namespace Ak {
 template<typename... Attribs>
 class OpenGLVertexBuffer;
 
+template<typename... Attribs>
+class OpenGLStreamingVertexBuffer;
+
 class OpenGLLidarRenderProgram final
 {
 public:
@@ -26,6 +29,15 @@ public:
 
   void render(const OpenGLVertexBuffer<glm::vec3, float>& buffer);
 
+  /// Renders a range of the points in a buffer.
+  void render(const OpenGLVertexBuffer<glm::vec3, float>& buffer, GLint firstVertex, GLsizei vertexCount);
+
+  /// Renders the points that were last written to a streaming buffer.
+  void render(const OpenGLStreamingVertexBuffer<glm::vec3, float>& buffer);
+
+private:
+  void renderPoints(GLint firstVertex, GLsizei vertexCount);
+
 private:
   OpenGLRenderbuffer m_depthBuffer;
 
@@ -0,0 +1,108 @@
+#pragma once
+
+#include <Ak/ObjMeshModel.h>
+#include <Ak/OpenGLIndexBuffer.h>
+#include <Ak/OpenGLVertexBuffer.h>
+#include <Ak/PackedVertexAttribs.h>
+
+#include <glad/glad.h>
+
+#include <glm/glm.hpp>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Ak {
+
+/// Packs the shapes of a scene into one vertex buffer and one index buffer, with one indirect draw command per shape,
+/// so that the whole scene is drawn with a single call to `glMultiDrawElementsIndirect`, no matter how many shapes it
+/// has.
+///
+/// The vertices are packed like @ref ObjMeshModel::packShape with a uniform scale. The offset and scale of each shape
+/// are a per-instance attribute (attribute index 3, after the vertex attributes) that each command selects with its
+/// base instance, which the HRT mesh shader reads as the instance transform.
+///
+/// The indirect buffer and a buffer with the bounding box of each shape are exposed, so that compute passes such as
+/// @ref OpenGLMeshCullingPass can decide on the GPU which commands are drawn.
+class OpenGLMeshBatch final
+{
+public:
+  /// The layout of a command in the indirect buffer, as defined by OpenGL.
+  struct DrawCommand final
+  {
+    GLuint indexCount;
+
+    GLuint instanceCount;
+
+    GLuint firstIndex;
+
+    GLint baseVertex;
+
+    GLuint baseInstance;
+  };
+
+  /// The bounding box of a shape, in the layout of the bounds buffer (std430, where a vec3 takes as much space as a
+  /// vec4).
+  struct ShapeBounds final
+  {
+    glm::vec4 min;
+
+    glm::vec4 max;
+  };
+
+  OpenGLMeshBatch();
+
+  OpenGLMeshBatch(const OpenGLMeshBatch&) = delete;
+
+  ~OpenGLMeshBatch();
+
+  /// Appends a shape to the batch. The buffers grow geometrically, so that shapes can be added one at a time as they
+  /// are loaded, for a constant cost per vertex on average. Only the new shape is uploaded, and the shapes already in
+  /// the batch are copied on the GPU when a buffer grows, so the batch keeps no copy of them on the CPU.
+  ///
+  /// @note The batch must not be bound while adding shapes.
+  void addShape(const ObjMeshModel::ShapeView& shapeView);
+
+  void bind();
+
+  void unbind();
+
+  bool isBound() const noexcept { return m_vertexBuffer.isBound(); }
+
+  /// Gets the number of commands to pass to `glMultiDrawElementsIndirect`, which is the number of shapes.
+  GLsizei getDrawCount() const noexcept { return GLsizei(m_drawCount); }
+
+  /// Gets the type of the indices to pass to the draw call.
+  static constexpr GLenum getIndexType() { return OpenGLIndexBuffer<std::uint32_t>::getIndexType(); }
+
+  /// Gets the buffer of @ref OpenGLMeshBatch::DrawCommand, one per shape, in the order the shapes were added.
+  GLuint indirectBufferID() const noexcept { return m_indirectBuffer; }
+
+  /// Gets the buffer of @ref OpenGLMeshBatch::ShapeBounds, one per shape, in the same order as the draw commands.
+  GLuint boundsBufferID() const noexcept { return m_boundsBuffer; }
+
+private:
+  using VertexBuffer = OpenGLVertexBuffer<PackedPosition, PackedNormal, PackedTexCoords>;
+
+  using TransformBuffer = OpenGLVertexBuffer<OpenGLPerInstance<glm::vec4>>;
+
+private:
+  VertexBuffer m_vertexBuffer;
+
+  OpenGLIndexBuffer<std::uint32_t> m_indexBuffer;
+
+  /// The offset (xyz) and scale (w) of the positions of each shape.
+  TransformBuffer m_transformBuffer;
+
+  GLuint m_indirectBuffer = 0;
+
+  GLuint m_boundsBuffer = 0;
+
+  /// The number of shapes, which is the number of elements in use in the indirect and bounds buffers.
+  std::size_t m_drawCount = 0;
+
+  /// The number of elements that the indirect and bounds buffers have room for.
+  std::size_t m_drawCapacity = 0;
+};
+
+} // namespace Ak
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <Ak/OpenGLShaderProgram.h>
+
+#include <glad/glad.h>
+
+#include <glm/fwd.hpp>
+
+namespace Ak {
+
+class OpenGLMeshBatch;
+class OpenGLTexture2D;
+
+/// Decides on the GPU which shapes of an @ref OpenGLMeshBatch are drawn, by setting the instance count of the draw
+/// command of each shape to zero or one. The batch is then drawn with the same indirect draw call as before, without
+/// reading anything back to the CPU.
+///
+/// A shape is culled when its bounding box is outside of the view frustum, or when it is behind the depth of the
+/// previous frame (hierarchical-Z occlusion culling). The depth is kept as a pyramid of mip levels where each texel has
+/// the farthest depth of the texels it covers, so a box is tested with four texel reads at the level that matches its
+/// size on the screen.
+///
+/// A frame goes like this:
+///
+/// @code
+/// cullingPass.cull(meshBatch, viewProjection);
+///
+/// hrtMeshRenderProgram.clear();
+/// // ... render the batch ...
+///
+/// cullingPass.updateDepthPyramid(*hrtMeshRenderProgram.normalDepthTexture(), width, height);
+/// @endcode
+///
+/// @note Since the depth comes from the previous frame, a shape that comes out from behind an occluder while the camera
+/// moves quickly may show up one frame late. When the camera jumps, call @ref
+/// OpenGLMeshCullingPass::invalidateDepthPyramid to only cull against the frustum until the next pyramid is built.
+class OpenGLMeshCullingPass final
+{
+public:
+  OpenGLMeshCullingPass();
+
+  OpenGLMeshCullingPass(const OpenGLMeshCullingPass&) = delete;
+
+  ~OpenGLMeshCullingPass();
+
+  /// Indicates if the compute shaders compiled and linked.
+  bool isInitialized();
+
+  /// Sets the instance count of every draw command of a batch, based on the bounds of its shape.
+  ///
+  /// @note The batch must not be bound. The draw commands are only valid for the view they were culled for, so this is
+  /// called every frame before drawing the batch.
+  ///
+  /// @param viewProjection The matrix that the batch is drawn with.
+  void cull(const OpenGLMeshBatch& meshBatch, const glm::mat4& viewProjection);
+
+  /// Builds the depth pyramid that the next call to @ref OpenGLMeshCullingPass::cull tests against.
+  ///
+  /// @param normalDepthTexture The normal/depth texture of @ref OpenGLHRTMeshRenderProgram, after the frame was
+  /// rendered to it.
+  ///
+  /// @param w The width of the texture.
+  ///
+  /// @param h The height of the texture.
+  void updateDepthPyramid(OpenGLTexture2D& normalDepthTexture, int w, int h);
+
+  /// Discards the depth pyramid, so that shapes are only culled against the frustum until the next call to @ref
+  /// OpenGLMeshCullingPass::updateDepthPyramid.
+  void invalidateDepthPyramid() noexcept { m_depthPyramidValid = false; }
+
+private:
+  void resizeDepthPyramid(int w, int h);
+
+  void buildDepthPyramidLevel(GLuint sourceTexture, GLint sourceLevel, GLint sourceChannel, GLint level);
+
+private:
+  OpenGLShaderProgram m_depthPyramidProgram;
+
+  OpenGLShaderProgram m_cullingProgram;
+
+  GLint m_sourceLevelLocation = -1;
+  GLint m_sourceChannelLocation = -1;
+  GLint m_viewProjectionLocation = -1;
+  GLint m_drawCountLocation = -1;
+  GLint m_occlusionCullingEnabledLocation = -1;
+
+  GLuint m_depthPyramid = 0;
+
+  int m_depthPyramidWidth = 0;
+
+  int m_depthPyramidHeight = 0;
+
+  GLint m_depthPyramidLevelCount = 0;
+
+  bool m_depthPyramidValid = false;
+};
+
+} // namespace Ak
@@ -18,6 +18,13 @@ public:
 
   void render(OpenGLVertexBuffer<glm::vec3, glm::vec4>& vertexBuffer);
 
+  /// Renders a range of the points in a buffer.
+  void render(OpenGLVertexBuffer<glm::vec3, glm::vec4>& vertexBuffer, GLint firstVertex, GLsizei vertexCount);
+
+  /// Renders several instances of the points in one draw call. The vertex buffer must have a buffer of per-instance
+  /// attributes attached to it, whose first attribute is the translation and uniform scale of each instance (a vec4).
+  void renderInstanced(OpenGLVertexBuffer<glm::vec3, glm::vec4>& vertexBuffer, GLsizei instanceCount);
+
 private:
   GLint m_mvpLocation = -1;
 };
@@ -4,6 +4,7 @@
 
 namespace Ak {
 
+/// A renderbuffer, which does not have to be bound to be resized.
 class OpenGLRenderbuffer final
 {
 public:
@@ -13,6 +13,9 @@ class OpenGLShaderProgram
 public:
   OpenGLShaderProgram(const char* vertShader, const char* fragShader);
 
+  /// Creates a program with only a compute shader, which is run with `glDispatchCompute` instead of a draw call.
+  explicit OpenGLShaderProgram(const char* compShader);
+
   OpenGLShaderProgram(const OpenGLShaderProgram&) = delete;
 
   virtual ~OpenGLShaderProgram();
@@ -29,6 +32,8 @@ public:
 
   std::string getFragInfoLog() const;
 
+  std::string getCompInfoLog() const;
+
   std::string getLinkInfoLog() const;
 
   GLint getUniformLocation(const char* name) const;
@@ -49,6 +54,9 @@ public:
 
   void setUniformValue(GLint location, const glm::mat4& value);
 
+private:
+  void readLinkInfoLog();
+
 private:
   GLuint m_programID = 0;
 
@@ -56,6 +64,8 @@ private:
 
   std::string m_fragInfoLog;
 
+  std::string m_compInfoLog;
+
   std::string m_linkInfoLog;
 
   bool m_boundFlag = false;
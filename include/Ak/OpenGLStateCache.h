@@ -0,0 +1,111 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include <array>
+
+#include <cstddef>
+
+namespace Ak {
+
+/// Keeps track of the objects bound to the current OpenGL context, so that binding an object that is already bound
+/// does not reach the driver. Every wrapper in this library binds through the cache.
+///
+/// Programs and vertex arrays are left bound when their wrapper is unbound, since only draw and dispatch calls read
+/// them and those always bind their own first. Binding the same program again, such as after setting a uniform, is
+/// then free, and switching to another one is a single call. Framebuffers and textures are unbound right away, because
+/// a framebuffer left bound would capture draw calls meant for the window, and a texture left bound would be sampled
+/// by shaders that expect nothing on its unit.
+///
+/// There is one cache per thread, which matches the context that is current on that thread. Code that binds objects
+/// without going through the cache, or that makes another context current, has to call @ref
+/// OpenGLStateCache::invalidate afterwards.
+class OpenGLStateCache final
+{
+public:
+  /// The number of calls that reached the driver, and the number of calls that the cache saved.
+  struct Counters final
+  {
+    std::size_t issuedCallCount = 0;
+
+    std::size_t skippedCallCount = 0;
+  };
+
+  /// Gets the cache of the context that is current on the calling thread.
+  static OpenGLStateCache& current();
+
+  OpenGLStateCache() noexcept;
+
+  OpenGLStateCache(const OpenGLStateCache&) = delete;
+
+  void useProgram(GLuint programID);
+
+  /// Indicates that a program no longer has to be in use, which leaves it in use until another one is.
+  void releaseProgram(GLuint programID);
+
+  void bindVertexArray(GLuint vertexArrayID);
+
+  /// Indicates that a vertex array no longer has to be bound, which leaves it bound until another one is.
+  void releaseVertexArray(GLuint vertexArrayID);
+
+  void bindFramebuffer(GLuint framebufferID);
+
+  /// Binds a 2D texture to the active texture unit.
+  void bindTexture2D(GLuint textureID);
+
+  /// Binds a 2D texture to a given texture unit, which becomes the active unit.
+  ///
+  /// @param unit The index of the unit, starting at zero (not `GL_TEXTURE0`).
+  void bindTexture2D(GLuint unit, GLuint textureID);
+
+  void activeTexture(GLuint unit);
+
+  // These are called right before an object is deleted, since deleting a bound object changes what is bound.
+
+  void forgetProgram(GLuint programID);
+
+  void forgetVertexArray(GLuint vertexArrayID);
+
+  void forgetFramebuffer(GLuint framebufferID);
+
+  void forgetTexture(GLuint textureID);
+
+  /// Forgets everything that is bound, so that the next bind of every kind of object reaches the driver.
+  void invalidate() noexcept;
+
+  /// Marks the end of a frame, after which @ref OpenGLStateCache::getFrameCounters returns the counts for that frame.
+  void endFrame() noexcept;
+
+  /// Gets the counts of the last frame that ended.
+  Counters getFrameCounters() const noexcept { return m_frameCounters; }
+
+  /// Gets the counts since the start of the current frame.
+  Counters getCounters() const noexcept { return m_counters; }
+
+private:
+  /// Returns true if a binding has to change, and counts the call either way.
+  bool update(GLuint& binding, GLuint objectID) noexcept;
+
+private:
+  /// Never the name of an object, so that the first bind of anything reaches the driver.
+  static constexpr GLuint unknownBinding = ~GLuint(0);
+
+  /// Texture units past this one are not cached.
+  static constexpr GLuint maxCachedTextureUnits = 16;
+
+  GLuint m_program = unknownBinding;
+
+  GLuint m_vertexArray = unknownBinding;
+
+  GLuint m_framebuffer = unknownBinding;
+
+  GLuint m_activeTextureUnit = unknownBinding;
+
+  std::array<GLuint, maxCachedTextureUnits> m_textures2D;
+
+  Counters m_counters;
+
+  Counters m_frameCounters;
+};
+
+} // namespace Ak
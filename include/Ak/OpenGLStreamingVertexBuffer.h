@@ -0,0 +1,311 @@
+#pragma once
+
+#include <Ak/OpenGLDirectStateAccess.h>
+#include <Ak/OpenGLStateCache.h>
+#include <Ak/OpenGLVertexBuffer.h>
+
+#include <glad/glad.h>
+
+#include <utility>
+#include <vector>
+
+#include <cassert>
+#include <cstddef>
+
+namespace Ak {
+
+/// A vertex buffer for data that is rewritten every frame, such as a live LiDAR feed.
+///
+/// The buffer is a ring of regions that stay mapped for the lifetime of the buffer (with `glBufferStorage` and
+/// `GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT`), so the CPU writes the vertices directly into memory that the GPU
+/// reads from. While the GPU draws from one region, the CPU writes into the next one, and a fence on each region keeps
+/// the CPU from overwriting vertices that a draw call has not read yet. With three regions, the CPU only waits when it
+/// runs more than two frames ahead of the GPU.
+///
+/// A frame goes like this:
+///
+/// @code
+/// auto* vertices = buffer.beginWrite();
+/// // ... write up to getCapacity() vertices ...
+/// buffer.endWrite(vertexCount);
+///
+/// buffer.bind();
+/// glDrawArrays(GL_POINTS, buffer.getFirstVertex(), buffer.getVertexCount());
+/// buffer.unbind();
+/// @endcode
+///
+/// @note On contexts older than OpenGL 4.4, each region is mapped with `GL_MAP_UNSYNCHRONIZED_BIT` for the duration of
+/// a write instead, which is still guarded by the fences.
+template<typename... Attribs>
+class OpenGLStreamingVertexBuffer final
+{
+public:
+  using Vertex = typename OpenGLVertexBuffer<Attribs...>::Vertex;
+
+  /// @param capacity The maximum number of vertices that can be written in one frame.
+  ///
+  /// @param regionCount The number of regions in the ring, which is how many frames the CPU can be ahead of the GPU.
+  OpenGLStreamingVertexBuffer(size_t capacity, size_t regionCount = 3);
+
+  OpenGLStreamingVertexBuffer(OpenGLStreamingVertexBuffer&&);
+
+  OpenGLStreamingVertexBuffer(const OpenGLStreamingVertexBuffer&) = delete;
+
+  ~OpenGLStreamingVertexBuffer();
+
+  void bind();
+
+  void unbind();
+
+  bool isBound() const noexcept { return m_boundFlag; }
+
+  /// Moves on to the next region of the ring and returns a pointer to it, waiting for the GPU if it is still reading
+  /// from that region. Draw calls issued before this call keep reading the previous region.
+  ///
+  /// @note The returned memory is write-only and may be uncached, so the vertices should be written in order and
+  /// never read back.
+  Vertex* beginWrite();
+
+  /// Makes the vertices written since @ref OpenGLStreamingVertexBuffer::beginWrite the ones that are drawn.
+  ///
+  /// @param vertexCount The number of vertices that were written, which must not exceed the capacity.
+  void endWrite(size_t vertexCount);
+
+  /// Gets the index of the first vertex of the region to draw from, to pass to the draw call.
+  GLint getFirstVertex() const noexcept { return GLint(m_currentRegion * m_capacity); }
+
+  /// Gets the number of vertices in the region to draw from.
+  GLsizei getVertexCount() const noexcept { return m_vertexCount; }
+
+  /// Gets the maximum number of vertices that can be written in one frame.
+  size_t getCapacity() const noexcept { return m_capacity; }
+
+private:
+  bool isPersistent() const noexcept { return m_mappedVertices != nullptr; }
+
+private:
+  GLuint m_vertexBuffer = 0;
+
+  GLuint m_vertexArrayObject = 0;
+
+  bool m_boundFlag = false;
+
+  size_t m_capacity = 0;
+
+  /// Only set when the buffer is persistently mapped.
+  Vertex* m_mappedVertices = nullptr;
+
+  /// One fence per region, which is signaled once the draw calls issued before the CPU moved away from the region are
+  /// done with it.
+  std::vector<GLsync> m_fences;
+
+  size_t m_currentRegion = 0;
+
+  GLsizei m_vertexCount = 0;
+};
+
+template<typename... Attribs>
+OpenGLStreamingVertexBuffer<Attribs...>::OpenGLStreamingVertexBuffer(size_t capacity, size_t regionCount)
+  : m_capacity(capacity)
+  , m_fences(regionCount, nullptr)
+{
+  assert(regionCount > 0);
+
+  static_assert(sizeof(Vertex) == Vertex::bytesPerVertex());
+
+  // The region index starts at the last region, so that the first write goes to the first one.
+  m_currentRegion = regionCount - 1;
+
+  const GLsizeiptr totalSize = GLsizeiptr(capacity * regionCount * Vertex::bytesPerVertex());
+
+  if (isDirectStateAccessAvailable()) {
+
+    // Buffer storage came before direct state access, so the buffer can always be mapped persistently here.
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glCreateVertexArrays(1, &m_vertexArrayObject);
+
+    glCreateBuffers(1, &m_vertexBuffer);
+
+    glNamedBufferStorage(m_vertexBuffer, totalSize, nullptr, flags);
+
+    m_mappedVertices = static_cast<Vertex*>(glMapNamedBufferRange(m_vertexBuffer, 0, totalSize, flags));
+
+    Vertex::enableAll(m_vertexArrayObject, m_vertexBuffer, 0, 0, Vertex::bytesPerVertex());
+
+    return;
+  }
+
+  glGenVertexArrays(1, &m_vertexArrayObject);
+
+  OpenGLStateCache::current().bindVertexArray(m_vertexArrayObject);
+
+  glGenBuffers(1, &m_vertexBuffer);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+  if (GLAD_GL_VERSION_4_4) {
+
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+    glBufferStorage(GL_ARRAY_BUFFER, totalSize, nullptr, flags);
+
+    m_mappedVertices = static_cast<Vertex*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, totalSize, flags));
+  }
+
+  if (!m_mappedVertices)
+    glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, GL_STREAM_DRAW);
+
+  Vertex::enableAll(0, 0, Vertex::bytesPerVertex());
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  OpenGLStateCache::current().releaseVertexArray(m_vertexArrayObject);
+}
+
+template<typename... Attribs>
+OpenGLStreamingVertexBuffer<Attribs...>::OpenGLStreamingVertexBuffer(OpenGLStreamingVertexBuffer<Attribs...>&& other)
+  : m_vertexBuffer(other.m_vertexBuffer)
+  , m_vertexArrayObject(other.m_vertexArrayObject)
+  , m_boundFlag(other.m_boundFlag)
+  , m_capacity(other.m_capacity)
+  , m_mappedVertices(other.m_mappedVertices)
+  , m_fences(std::move(other.m_fences))
+  , m_currentRegion(other.m_currentRegion)
+  , m_vertexCount(other.m_vertexCount)
+{
+  other.m_vertexBuffer = 0;
+  other.m_vertexArrayObject = 0;
+  other.m_boundFlag = false;
+  other.m_mappedVertices = nullptr;
+  other.m_fences.clear();
+}
+
+template<typename... Attribs>
+OpenGLStreamingVertexBuffer<Attribs...>::~OpenGLStreamingVertexBuffer()
+{
+  for (GLsync fence : m_fences) {
+    if (fence)
+      glDeleteSync(fence);
+  }
+
+  // Deleting the buffer also unmaps it.
+  if (m_vertexBuffer)
+    glDeleteBuffers(1, &m_vertexBuffer);
+
+  if (m_vertexArrayObject) {
+    OpenGLStateCache::current().forgetVertexArray(m_vertexArrayObject);
+    glDeleteVertexArrays(1, &m_vertexArrayObject);
+  }
+}
+
+template<typename... Attribs>
+void
+OpenGLStreamingVertexBuffer<Attribs...>::bind()
+{
+  assert(!m_boundFlag);
+
+  OpenGLStateCache::current().bindVertexArray(m_vertexArrayObject);
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+  m_boundFlag = true;
+}
+
+template<typename... Attribs>
+void
+OpenGLStreamingVertexBuffer<Attribs...>::unbind()
+{
+  assert(m_boundFlag);
+
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  OpenGLStateCache::current().releaseVertexArray(m_vertexArrayObject);
+
+  m_boundFlag = false;
+}
+
+template<typename... Attribs>
+auto
+OpenGLStreamingVertexBuffer<Attribs...>::beginWrite() -> Vertex*
+{
+  assert(!m_boundFlag);
+
+  // Every draw call that reads the current region has been issued by now, so a fence placed here covers all of them.
+
+  GLsync& previousFence = m_fences[m_currentRegion];
+
+  if (previousFence)
+    glDeleteSync(previousFence);
+
+  previousFence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+  m_currentRegion = (m_currentRegion + 1) % m_fences.size();
+
+  GLsync& fence = m_fences[m_currentRegion];
+
+  if (fence) {
+
+    // The first wait flushes the fence to the GPU, in case it is still queued on the CPU side.
+
+    GLbitfield waitFlags = GL_SYNC_FLUSH_COMMANDS_BIT;
+
+    const GLuint64 timeout = 1000000000;
+
+    while (glClientWaitSync(fence, waitFlags, timeout) == GL_TIMEOUT_EXPIRED)
+      waitFlags = 0;
+
+    glDeleteSync(fence);
+
+    fence = nullptr;
+  }
+
+  if (isPersistent())
+    return m_mappedVertices + (m_currentRegion * m_capacity);
+
+  // The fence already guarantees that the GPU is done with the region, so the driver does not need to synchronize.
+
+  const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+
+  const size_t byteOffset = m_currentRegion * m_capacity * Vertex::bytesPerVertex();
+
+  const size_t byteCount = m_capacity * Vertex::bytesPerVertex();
+
+  void* vertices = nullptr;
+
+  if (isDirectStateAccessAvailable()) {
+    vertices = glMapNamedBufferRange(m_vertexBuffer, GLintptr(byteOffset), GLsizeiptr(byteCount), flags);
+  } else {
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+    vertices = glMapBufferRange(GL_ARRAY_BUFFER, GLintptr(byteOffset), GLsizeiptr(byteCount), flags);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  return static_cast<Vertex*>(vertices);
+}
+
+template<typename... Attribs>
+void
+OpenGLStreamingVertexBuffer<Attribs...>::endWrite(size_t vertexCount)
+{
+  assert(!m_boundFlag);
+
+  assert(vertexCount <= m_capacity);
+
+  if (!isPersistent() && isDirectStateAccessAvailable()) {
+    glUnmapNamedBuffer(m_vertexBuffer);
+  } else if (!isPersistent()) {
+    glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+  }
+
+  m_vertexCount = GLsizei(vertexCount);
+}
+
+} // namespace Ak
@@ -6,6 +6,8 @@
 
 namespace Ak {
 
+/// A 2D texture. Its functions do not require it to be bound: with direct state access they edit the texture by name,
+/// and otherwise they bind it for the duration of the call if it is not bound already.
 class OpenGLTexture2D final
 {
 public:
@@ -19,8 +21,6 @@ public:
 
   /// Opens an image file and loads the data onto the texture.
   ///
-  /// @note The texture must be bound before calling this function.
-  ///
   /// @param path The path of the image to open.
   ///
   /// @param flipVertically Whether or not the image should be flipped when loaded.
@@ -30,8 +30,6 @@ public:
 
   /// Saves the contents of the texture to a PNG file.
   ///
-  /// @note The texture must be bound before calling this function.
-  ///
   /// @param path The path to save the file to.
   ///
   /// @param format The format to read the texture in. Only 1, 3, and 4 channel formats are supported.
@@ -51,6 +49,8 @@ public:
 
   void setMinMagFilters(GLenum minFilter, GLenum magFilter);
 
+  /// @note This always goes through the bind point, since the size of a texture can only change after it is created
+  /// through the functions that predate direct state access.
   void resize(GLint w, GLint h, GLenum internalFormat, GLenum format, GLenum type);
 
   void write(GLint x, GLint y, GLint w, GLint h, GLenum format, GLenum type, const void* pixels);
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <Ak/OpenGLTexture2D.h>
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <cstddef>
+
+namespace Ak {
+
+class ObjMeshModel;
+
+/// A set of textures loaded from image files, in which each image is decoded and uploaded once, no matter how many
+/// materials refer to it. The images are decoded in parallel, and only the uploads happen on the calling thread, which
+/// must own the OpenGL context.
+class OpenGLTextureCache final
+{
+public:
+  /// Loads the images that are not in the cache yet. An image that fails to load is remembered as missing, so that it
+  /// is not decoded again by later calls.
+  ///
+  /// @param paths The paths of the images. Duplicates and empty paths are skipped.
+  ///
+  /// @param flipVertically Whether or not the images should be flipped when loaded.
+  ///
+  /// @return The number of images that failed to load in this call.
+  std::size_t load(const std::vector<std::string>& paths, bool flipVertically = true);
+
+  /// Loads the textures used by the materials of the shapes of a model.
+  ///
+  /// @return The number of images that failed to load in this call.
+  std::size_t loadMaterialTextures(const ObjMeshModel& objMeshModel, bool flipVertically = true);
+
+  /// Gets the texture loaded from an image.
+  ///
+  /// @return The texture, or null if the image was not loaded or failed to load.
+  OpenGLTexture2D* find(const std::string& path) noexcept;
+
+  /// Gets the number of images that were loaded successfully.
+  std::size_t getTextureCount() const noexcept;
+
+  /// Releases all of the textures.
+  void clear() noexcept { m_textures.clear(); }
+
+private:
+  /// Null for the images that failed to load.
+  std::map<std::string, std::unique_ptr<OpenGLTexture2D>> m_textures;
+};
+
+} // namespace Ak
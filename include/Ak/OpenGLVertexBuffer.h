@@ -1,9 +1,15 @@
 #pragma once
 
+#include <Ak/OpenGLDirectStateAccess.h>
+#include <Ak/OpenGLStateCache.h>
+#include <Ak/PackedVertexAttribs.h>
+
 #include <glad/glad.h>
 
 #include <glm/glm.hpp>
 
+#include <algorithm>
+
 #include <cassert>
 #include <cstddef>
 
@@ -53,9 +59,87 @@ struct OpenGLVertexAttribTraits<glm::vec4> final
   static constexpr GLboolean normalized() { return GL_FALSE; }
 };
 
+/// Read as a vec3 in the shader, in the range [0, 1] on each axis. The bounding box of the positions has to be applied
+/// separately, usually by folding it into the model matrix.
+template<>
+struct OpenGLVertexAttribTraits<PackedPosition> final
+{
+  static constexpr GLint size() { return 3; }
+
+  static constexpr GLenum type() { return GL_UNSIGNED_SHORT; }
+
+  static constexpr GLboolean normalized() { return GL_TRUE; }
+};
+
+/// Read as a vec3 (or vec4, with a w of zero) in the shader.
+template<>
+struct OpenGLVertexAttribTraits<PackedNormal> final
+{
+  static constexpr GLint size() { return 4; }
+
+  static constexpr GLenum type() { return GL_INT_2_10_10_10_REV; }
+
+  static constexpr GLboolean normalized() { return GL_TRUE; }
+};
+
+/// Read as a vec2 in the shader.
+template<>
+struct OpenGLVertexAttribTraits<PackedTexCoords> final
+{
+  static constexpr GLint size() { return 2; }
+
+  static constexpr GLenum type() { return GL_HALF_FLOAT; }
+
+  static constexpr GLboolean normalized() { return GL_FALSE; }
+};
+
+/// Marks an attribute as per-instance, so that it advances once per instance of an instanced draw call instead of once
+/// per vertex. A buffer of per-instance attributes is drawn by attaching it to the buffer of the mesh that it is an
+/// instance of, with @ref OpenGLVertexBuffer::attach.
+template<typename Attrib>
+struct OpenGLPerInstance final
+{
+  Attrib value;
+};
+
+template<typename Attrib>
+struct OpenGLVertexAttribTraits<OpenGLPerInstance<Attrib>> final
+{
+  static constexpr GLint size() { return OpenGLVertexAttribTraits<Attrib>::size(); }
+
+  static constexpr GLenum type() { return OpenGLVertexAttribTraits<Attrib>::type(); }
+
+  static constexpr GLboolean normalized() { return OpenGLVertexAttribTraits<Attrib>::normalized(); }
+};
+
+/// The number of instances that each value of an attribute is used for, or zero to use one value per vertex.
+template<typename Attrib>
+struct OpenGLVertexAttribDivisor final
+{
+  static constexpr GLuint value() { return 0; }
+};
+
+template<typename Attrib>
+struct OpenGLVertexAttribDivisor<OpenGLPerInstance<Attrib>> final
+{
+  static constexpr GLuint value() { return 1; }
+};
+
+template<typename Index>
+class OpenGLIndexBuffer;
+
+/// A vertex buffer, with the vertex array object that describes its attributes. Vertices can be written and other
+/// buffers attached without binding it: with direct state access the buffer and vertex array are edited by name, and
+/// otherwise the data goes through the copy binding point.
 template<typename... Attribs>
 class OpenGLVertexBuffer final
 {
+  template<typename... OtherAttribs>
+  friend class OpenGLVertexBuffer;
+
+  template<typename Index>
+  friend class OpenGLIndexBuffer;
+
 public:
   template<typename Attrib, typename... Others>
   struct GenericVertex final
@@ -84,8 +168,20 @@ public:
       glVertexAttribPointer(
         attribIndex, Traits::size(), Traits::type(), Traits::normalized(), bytesPerVertex, (const void*)offset);
 
+      glVertexAttribDivisor(attribIndex, OpenGLVertexAttribDivisor<Attrib>::value());
+
       GenericVertex<Others...>::enableAll(attribIndex + 1, offset + sizeof(Attrib), bytesPerVertex);
     }
+
+    /// Enables the attributes on a vertex array by name, with one buffer binding per attribute (at the index of the
+    /// attribute), which is what glVertexAttribPointer does behind the scenes.
+    static void enableAll(GLuint vertexArray, GLuint buffer, GLuint attribIndex, size_t offset, size_t bytesPerVertex)
+    {
+      GenericVertex<Attrib>::enableAll(vertexArray, buffer, attribIndex, offset, bytesPerVertex);
+
+      GenericVertex<Others...>::enableAll(
+        vertexArray, buffer, attribIndex + 1, offset + sizeof(Attrib), bytesPerVertex);
+    }
   };
 
   template<typename LastAttrib>
@@ -111,6 +207,23 @@ public:
 
       glVertexAttribPointer(
         attribIndex, Traits::size(), Traits::type(), Traits::normalized(), bytesPerVertex, (const void*)offset);
+
+      glVertexAttribDivisor(attribIndex, OpenGLVertexAttribDivisor<LastAttrib>::value());
+    }
+
+    static void enableAll(GLuint vertexArray, GLuint buffer, GLuint attribIndex, size_t offset, size_t bytesPerVertex)
+    {
+      using Traits = OpenGLVertexAttribTraits<LastAttrib>;
+
+      glEnableVertexArrayAttrib(vertexArray, attribIndex);
+
+      glVertexArrayAttribFormat(vertexArray, attribIndex, Traits::size(), Traits::type(), Traits::normalized(), 0);
+
+      glVertexArrayAttribBinding(vertexArray, attribIndex, attribIndex);
+
+      glVertexArrayVertexBuffer(vertexArray, attribIndex, buffer, GLintptr(offset), GLsizei(bytesPerVertex));
+
+      glVertexArrayBindingDivisor(vertexArray, attribIndex, OpenGLVertexAttribDivisor<LastAttrib>::value());
     }
   };
 
@@ -130,12 +243,19 @@ public:
 
   bool isBound() const noexcept { return m_boundFlag; }
 
-  /// Resizes the buffer to fit a given number of vertices.
+  /// Resizes the buffer to fit a given number of vertices. The buffer is empty afterwards, until vertices are written
+  /// to it.
   ///
   /// @param vertexCount The number of vertices to allocate room for.
   void allocate(size_t vertexCount, GLenum usage);
 
-  /// @note Must be allocated with @ref OpenGLVertexBuffer::resize before calling this function.
+  /// Resizes the buffer to fit a given number of vertices, keeping the vertices in use. The vertices are copied on the
+  /// GPU, so buffers that are appended to do not need a copy of their contents on the CPU.
+  ///
+  /// @param vertexCount The number of vertices to allocate room for, which must be at least the number in use.
+  void reserve(size_t vertexCount, GLenum usage);
+
+  /// @note Must be allocated with @ref OpenGLVertexBuffer::allocate before calling this function.
   ///
   /// @param offset The index of the vertex to start writing the data to.
   ///
@@ -144,10 +264,31 @@ public:
   /// @param vertexCount The number of vertices to write to the buffer.
   void write(size_t offset, const Vertex* data, size_t vertexCount);
 
-  /// Gets the number of vertices in the buffer.
+  /// Adds the attributes of another buffer to the vertex array of this one, so that both are read by the same draw
+  /// calls. This is how a buffer of per-instance attributes is combined with the vertices of a mesh.
+  ///
+  /// @param other The buffer to read the attributes from, which must outlive its use by this one and must not be bound.
+  ///
+  /// @param firstAttribIndex The attribute index of the first attribute of the other buffer, which by default follows
+  /// the attributes of this buffer.
+  template<typename... OtherAttribs>
+  void attach(const OpenGLVertexBuffer<OtherAttribs...>& other, GLuint firstAttribIndex = sizeof...(Attribs));
+
+  /// Gets the number of vertices in use, which is the end of the furthest range written since the last allocation.
   ///
-  /// @note The vertex buffer must be bound before calling this function.
-  size_t getVertexCount() const;
+  /// @note This is tracked on the CPU, so it can be called in a draw loop without querying the driver.
+  size_t getVertexCount() const noexcept { return m_vertexCount; }
+
+  /// Gets the number of vertices that the buffer has room for.
+  size_t getVertexCapacity() const noexcept { return m_vertexCapacity; }
+
+  /// Sets the number of vertices in use, for when a buffer is reused for fewer vertices than it was filled with.
+  void setVertexCount(size_t vertexCount) noexcept
+  {
+    assert(vertexCount <= m_vertexCapacity);
+
+    m_vertexCount = vertexCount;
+  }
 
 private:
   GLuint m_vertexBuffer = 0;
@@ -155,14 +296,29 @@ private:
   GLuint m_vertexArrayObject = 0;
 
   bool m_boundFlag = false;
+
+  size_t m_vertexCapacity = 0;
+
+  size_t m_vertexCount = 0;
 };
 
 template<typename... Attribs>
 OpenGLVertexBuffer<Attribs...>::OpenGLVertexBuffer()
 {
+  if (isDirectStateAccessAvailable()) {
+
+    glCreateVertexArrays(1, &m_vertexArrayObject);
+
+    glCreateBuffers(1, &m_vertexBuffer);
+
+    Vertex::enableAll(m_vertexArrayObject, m_vertexBuffer, 0, 0, Vertex::bytesPerVertex());
+
+    return;
+  }
+
   glGenVertexArrays(1, &m_vertexArrayObject);
 
-  glBindVertexArray(m_vertexArrayObject);
+  OpenGLStateCache::current().bindVertexArray(m_vertexArrayObject);
 
   glGenBuffers(1, &m_vertexBuffer);
 
@@ -172,18 +328,22 @@ OpenGLVertexBuffer<Attribs...>::OpenGLVertexBuffer()
 
   glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-  glBindVertexArray(0);
+  OpenGLStateCache::current().releaseVertexArray(m_vertexArrayObject);
 }
 
 template<typename... Attribs>
 OpenGLVertexBuffer<Attribs...>::OpenGLVertexBuffer(OpenGLVertexBuffer<Attribs...>&& other)
-  : m_vertexArrayObject(other.m_vertexArrayObject)
-  , m_vertexBuffer(other.m_vertexBuffer)
+  : m_vertexBuffer(other.m_vertexBuffer)
+  , m_vertexArrayObject(other.m_vertexArrayObject)
   , m_boundFlag(other.m_boundFlag)
+  , m_vertexCapacity(other.m_vertexCapacity)
+  , m_vertexCount(other.m_vertexCount)
 {
   other.m_vertexArrayObject = 0;
   other.m_vertexBuffer = 0;
   other.m_boundFlag = false;
+  other.m_vertexCapacity = 0;
+  other.m_vertexCount = 0;
 }
 
 template<typename... Attribs>
@@ -192,75 +352,121 @@ OpenGLVertexBuffer<Attribs...>::~OpenGLVertexBuffer()
   if (m_vertexBuffer)
     glDeleteBuffers(1, &m_vertexBuffer);
 
-  if (m_vertexArrayObject)
+  if (m_vertexArrayObject) {
+    OpenGLStateCache::current().forgetVertexArray(m_vertexArrayObject);
     glDeleteVertexArrays(1, &m_vertexArrayObject);
+  }
 }
 
 template<typename... Attribs>
 void
 OpenGLVertexBuffer<Attribs...>::allocate(size_t vertexCount, GLenum usage)
 {
-  assert(m_boundFlag);
-
   static_assert(sizeof(Vertex) == Vertex::bytesPerVertex());
 
-  const size_t totalSize = vertexCount * Vertex::bytesPerVertex();
+  const GLsizeiptr totalSize = GLsizeiptr(vertexCount * Vertex::bytesPerVertex());
+
+  if (isDirectStateAccessAvailable()) {
+    glNamedBufferData(m_vertexBuffer, totalSize, nullptr, usage);
+  } else {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+    glBufferData(GL_COPY_WRITE_BUFFER, totalSize, nullptr, usage);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  m_vertexCapacity = vertexCount;
+
+  m_vertexCount = 0;
+}
+
+template<typename... Attribs>
+void
+OpenGLVertexBuffer<Attribs...>::reserve(size_t vertexCount, GLenum usage)
+{
+  assert(vertexCount >= m_vertexCount);
+
+  const GLsizeiptr keptSize = GLsizeiptr(m_vertexCount * Vertex::bytesPerVertex());
 
-  glBufferData(GL_ARRAY_BUFFER, totalSize, nullptr, usage);
+  resizeBufferKeepingContents(m_vertexBuffer, keptSize, GLsizeiptr(vertexCount * Vertex::bytesPerVertex()), usage);
+
+  m_vertexCapacity = vertexCount;
 }
 
 template<typename... Attribs>
 void
 OpenGLVertexBuffer<Attribs...>::write(size_t offset, const Vertex* vertices, size_t vertexCount)
 {
-  assert(m_boundFlag);
+  assert((offset + vertexCount) <= m_vertexCapacity);
 
   static_assert(sizeof(Vertex) == Vertex::bytesPerVertex());
 
-  const size_t byteOffset = Vertex::bytesPerVertex() * offset;
+  const GLintptr byteOffset = GLintptr(Vertex::bytesPerVertex() * offset);
 
-  const size_t byteCount = Vertex::bytesPerVertex() * vertexCount;
+  const GLsizeiptr byteCount = GLsizeiptr(Vertex::bytesPerVertex() * vertexCount);
 
-  glBufferSubData(GL_ARRAY_BUFFER, byteOffset, byteCount, vertices);
+  if (isDirectStateAccessAvailable()) {
+    glNamedBufferSubData(m_vertexBuffer, byteOffset, byteCount, vertices);
+  } else {
+    glBindBuffer(GL_COPY_WRITE_BUFFER, m_vertexBuffer);
+    glBufferSubData(GL_COPY_WRITE_BUFFER, byteOffset, byteCount, vertices);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+  }
+
+  m_vertexCount = std::max(m_vertexCount, offset + vertexCount);
 }
 
 template<typename... Attribs>
+template<typename... OtherAttribs>
 void
-OpenGLVertexBuffer<Attribs...>::bind()
+OpenGLVertexBuffer<Attribs...>::attach(const OpenGLVertexBuffer<OtherAttribs...>& other, GLuint firstAttribIndex)
 {
-  assert(!m_boundFlag);
+  using OtherVertex = typename OpenGLVertexBuffer<OtherAttribs...>::Vertex;
 
-  glBindVertexArray(m_vertexArrayObject);
+  // Binding the other buffer would switch to its vertex array, so its attributes would not end up in this one.
+  assert(!other.isBound());
 
-  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
+  if (isDirectStateAccessAvailable()) {
 
-  m_boundFlag = true;
+    const size_t bytesPerVertex = OtherVertex::bytesPerVertex();
+
+    OtherVertex::enableAll(m_vertexArrayObject, other.m_vertexBuffer, firstAttribIndex, 0, bytesPerVertex);
+
+    return;
+  }
+
+  OpenGLScopedBind<OpenGLVertexBuffer<Attribs...>> scopedBind(*this);
+
+  glBindBuffer(GL_ARRAY_BUFFER, other.m_vertexBuffer);
+
+  OtherVertex::enableAll(firstAttribIndex, 0, OtherVertex::bytesPerVertex());
+
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
 }
 
 template<typename... Attribs>
 void
-OpenGLVertexBuffer<Attribs...>::unbind()
+OpenGLVertexBuffer<Attribs...>::bind()
 {
-  assert(m_boundFlag);
+  assert(!m_boundFlag);
 
-  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  OpenGLStateCache::current().bindVertexArray(m_vertexArrayObject);
 
-  glBindVertexArray(0);
+  glBindBuffer(GL_ARRAY_BUFFER, m_vertexBuffer);
 
-  m_boundFlag = false;
+  m_boundFlag = true;
 }
 
 template<typename... Attribs>
-size_t
-OpenGLVertexBuffer<Attribs...>::getVertexCount() const
+void
+OpenGLVertexBuffer<Attribs...>::unbind()
 {
   assert(m_boundFlag);
 
-  GLint size = 0;
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-  glGetBufferParameteriv(GL_ARRAY_BUFFER, GL_BUFFER_SIZE, &size);
+  OpenGLStateCache::current().releaseVertexArray(m_vertexArrayObject);
 
-  return size_t(size) / Vertex::bytesPerVertex();
+  m_boundFlag = false;
 }
 
 } // namespace Ak
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+namespace Ak {
+
+/// A position stored as three unsigned normalized 16-bit integers, relative to a bounding box that is given separately
+/// (usually one per shape). The fourth integer is padding, which keeps the next attribute aligned to four bytes.
+struct PackedPosition final
+{
+  std::uint16_t x;
+
+  std::uint16_t y;
+
+  std::uint16_t z;
+
+  std::uint16_t padding;
+};
+
+/// A normal stored as three signed normalized 10-bit integers, in the layout of GL_INT_2_10_10_10_REV. The two
+/// remaining bits are zero.
+struct PackedNormal final
+{
+  std::uint32_t bits;
+};
+
+/// Texture coordinates stored as two half precision floats.
+struct PackedTexCoords final
+{
+  std::uint16_t u;
+
+  std::uint16_t v;
+};
+
+/// Converts a float to a half precision float, rounding to the nearest value.
+inline std::uint16_t
+packHalf(float value) noexcept
+{
+  std::uint32_t bits = 0;
+
+  std::memcpy(&bits, &value, sizeof(bits));
+
+  const std::uint32_t sign = (bits >> 16) & 0x8000u;
+
+  const std::uint32_t magnitudeBits = bits & 0x7fffffffu;
+
+  // Infinity and NaN, which stays a NaN.
+  if (magnitudeBits >= 0x7f800000u)
+    return std::uint16_t(sign | 0x7c00u | ((magnitudeBits > 0x7f800000u) ? 0x200u : 0u));
+
+  // Values that round past the largest half (65504) overflow to infinity.
+  if (magnitudeBits >= 0x477ff000u)
+    return std::uint16_t(sign | 0x7c00u);
+
+  // Values below the smallest normal half (2^-14) become subnormals, which are multiples of 2^-24.
+  if (magnitudeBits < 0x38800000u) {
+
+    float magnitude = 0;
+
+    std::memcpy(&magnitude, &magnitudeBits, sizeof(magnitude));
+
+    return std::uint16_t(sign | std::uint32_t(std::nearbyint(magnitude * 16777216.0f)));
+  }
+
+  // Rebias the exponent and drop the low 13 bits of the mantissa, rounding half to even.
+
+  const std::uint32_t rounded = magnitudeBits + 0xfffu + ((magnitudeBits >> 13) & 1u);
+
+  return std::uint16_t(sign | ((rounded - 0x38000000u) >> 13));
+}
+
+inline float
+unpackHalf(std::uint16_t half) noexcept
+{
+  const std::uint32_t sign = std::uint32_t(half & 0x8000u) << 16;
+
+  const std::uint32_t exponent = (half >> 10) & 0x1fu;
+
+  const std::uint32_t mantissa = half & 0x3ffu;
+
+  if (exponent == 0) {
+    const float magnitude = std::ldexp(float(mantissa), -24);
+    return sign ? -magnitude : magnitude;
+  }
+
+  const std::uint32_t bits = sign | ((exponent == 0x1fu) ? 0x7f800000u : ((exponent + 112) << 23)) | (mantissa << 13);
+
+  float value = 0;
+
+  std::memcpy(&value, &bits, sizeof(value));
+
+  return value;
+}
+
+inline PackedNormal
+packNormal(float x, float y, float z) noexcept
+{
+  auto encode = [](float value) -> std::uint32_t {
+    const int snorm = int(std::lround(std::clamp(value, -1.0f, 1.0f) * 511.0f));
+    return std::uint32_t(snorm) & 0x3ffu;
+  };
+
+  return PackedNormal{ encode(x) | (encode(y) << 10) | (encode(z) << 20) };
+}
+
+/// Decodes one of the three components of a packed normal, the same way OpenGL does.
+inline float
+unpackNormal(PackedNormal normal, int axis) noexcept
+{
+  const std::uint32_t bits = (normal.bits >> (axis * 10)) & 0x3ffu;
+
+  // Sign extend the 10-bit integer.
+  const int snorm = int(bits ^ 0x200u) - 0x200;
+
+  return std::max(float(snorm) / 511.0f, -1.0f);
+}
+
+} // namespace Ak
@@ -1,27 +1,58 @@
 #pragma once
 
+#include <Ak/Constants.h>
+#include <Ak/MappedFile.h>
 #include <Ak/ObjMeshModel.h>
+#include <Ak/RTPacketTraverser.h>
+#include <Ak/RTQuantizedBvh.h>
+#include <Ak/RTWideBvh.h>
 
+#include <bvh/binned_sah_builder.hpp>
+#include <bvh/bounding_box.hpp>
 #include <bvh/bvh.hpp>
+#include <bvh/linear_bvh_builder.hpp>
 #include <bvh/primitive_intersectors.hpp>
 #include <bvh/single_ray_traverser.hpp>
 #include <bvh/sweep_sah_builder.hpp>
 #include <bvh/triangle.hpp>
 
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include <cassert>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 
 namespace Ak {
 
-template<typename Float>
+/// A triangle mesh prepared for ray tracing.
+///
+/// @tparam Float The floating point type of the triangles and the rays.
+///
+/// @tparam Width The number of children per node of the BVH used by the single ray queries. With a width of 2, the
+/// binary BVH is traversed directly. With a width of 4 or 8, the binary BVH is collapsed into a @ref RTWideBvh after
+/// it is built, which matches the SIMD width of SSE and AVX respectively. The packet queries always use the binary BVH.
+template<typename Float, std::size_t Width = 2>
 class RTMeshModel final
 {
 public:
+  static_assert((Width == 2) || (Width == 4) || (Width == 8), "The BVH width must be 2, 4 or 8.");
+
   using Vec2 = bvh::Vector<Float, 2>;
 
   using Vec3 = bvh::Vector<Float, 3>;
 
   using Triangle = bvh::Triangle<Float>;
 
+  using BoundingBox = bvh::BoundingBox<Float>;
+
   using Bvh = bvh::Bvh<Float>;
 
   using Ray = bvh::Ray<Float>;
@@ -32,10 +63,17 @@ public:
 
   using Traverser = bvh::SingleRayTraverser<Bvh>;
 
+  using WideBvh = RTWideBvh<Float, Width>;
+
+  using QuantizedBvh16 = RTQuantizedBvh<Float, Width, std::uint16_t>;
+
+  using QuantizedBvh8 = RTQuantizedBvh<Float, Width, std::uint8_t>;
+
   using ClosestHit = typename ClosestIntersector::Result;
 
   using AnyHit = typename AnyIntersector::Result;
 
+  /// The attributes of the three vertices of a triangle, as returned by @ref RTMeshModel::getAttrib.
   struct Attrib final
   {
     Vec3 normals[3];
@@ -43,38 +81,377 @@ public:
     Vec2 texCoords[3];
   };
 
+  /// Selects the algorithm used to build the BVH, which trades the time it takes to build the BVH for the time it
+  /// takes to trace rays through it. All of them run in parallel when OpenMP is available.
+  enum class BuildQuality
+  {
+    /// Builds a linear BVH by sorting the triangles along a Morton curve. This is the fastest to build, but produces
+    /// the slowest BVH to traverse.
+    low,
+    /// Builds the BVH with the surface area heuristic, evaluated on a fixed number of bins per axis.
+    medium,
+    /// Builds the BVH with the surface area heuristic, evaluated on every possible split. This is the slowest to build,
+    /// but produces the fastest BVH to traverse.
+    high
+  };
+
+  /// Selects how the nodes of the BVH used for single ray queries are stored.
+  enum class NodeFormat
+  {
+    /// The bounds are stored at full precision, and the model keeps everything it needs to refit the BVH, trace
+    /// packets and save a cache.
+    full,
+    /// The bounds of the children of a node are stored as 16-bit integers relative to the bounds of the node.
+    quantized16,
+    /// The bounds of the children of a node are stored as 8-bit integers relative to the bounds of the node. This is
+    /// the smallest format, but the boxes are looser, so more of them are visited by each ray.
+    quantized8
+  };
+
+  /// A breakdown of the memory used by the model, in bytes.
+  struct MemoryReport final
+  {
+    std::size_t triangleBytes = 0;
+
+    std::size_t attribBytes = 0;
+
+    /// The nodes of all the trees that are kept in memory.
+    std::size_t nodeBytes = 0;
+
+    /// The primitive indices of the BVH and the triangle sources.
+    std::size_t indexBytes = 0;
+
+    std::size_t triangleCount = 0;
+
+    std::size_t getTotalBytes() const noexcept { return triangleBytes + attribBytes + nodeBytes + indexBytes; }
+
+    double getBytesPerTriangle() const noexcept
+    {
+      return triangleCount ? (double(getTotalBytes()) / triangleCount) : 0;
+    }
+  };
+
   static std::vector<RTMeshModel> fromObjModel(const ObjMeshModel& objMeshModel);
 
-  void commit();
+  /// Builds the BVH for the triangles of the model, replacing the previous one if there was one.
+  ///
+  /// @param quality The algorithm to build the BVH with.
+  void commit(BuildQuality quality = BuildQuality::high);
 
   void useObjModel(const ObjMeshModel& objMeshModel);
 
+  /// Sets the format of the BVH nodes, which takes effect at the next call to @ref RTMeshModel::commit, @ref
+  /// RTMeshModel::loadCache or @ref RTMeshModel::refit. Nothing is rebuilt right away, and the queries keep using the
+  /// tree that was built until then.
+  ///
+  /// With a quantized format, the full precision nodes are released once the quantized nodes are built. This makes
+  /// the model meant for static meshes: refitting rebuilds the BVH from scratch, packet queries trace each ray on its
+  /// own, and the cache cannot be saved.
+  void setNodeFormat(NodeFormat nodeFormat) noexcept { m_nodeFormat = nodeFormat; }
+
+  NodeFormat getNodeFormat() const noexcept { return m_nodeFormat; }
+
+  /// Replaces the vertex positions of the triangles, keeping the topology of the mesh. This is meant for animated or
+  /// deforming meshes, and should be followed by a call to @ref RTMeshModel::refit.
+  ///
+  /// @param positions The new positions, three per triangle, in the order the triangles were given to the model (the
+  /// same order as the corners of the triangles of @ref ObjMeshModel::ShapeView).
+  ///
+  /// @param vertexCount The number of positions. This must be three times the number of triangles.
+  void updatePositions(const Vec3* positions, std::size_t vertexCount);
+
+  /// Updates the bounds of the BVH nodes after the positions have changed, keeping the structure of the tree. The
+  /// nodes are updated bottom up, one level of the tree at a time, with the nodes of each level updated in parallel.
+  /// The cost is linear in the number of triangles, which is much cheaper than a rebuild.
+  ///
+  /// @note The model must be committed before calling this function.
+  ///
+  /// @param maxCostRatio A refitted tree gets worse as the triangles move away from where they were when it was built.
+  /// If the SAH cost of the refitted tree exceeds its cost at build time by more than this ratio, the BVH is rebuilt
+  /// instead. The default never rebuilds.
+  ///
+  /// @param rebuildQuality The quality to rebuild the BVH with, if it gets rebuilt.
+  ///
+  /// @return True if the tree was refitted, false if it had to be rebuilt.
+  bool refit(Float maxCostRatio = Infinity<Float>::value(), BuildQuality rebuildQuality = BuildQuality::medium);
+
+  /// Saves the triangles, attributes and BVH of the model to a file, so that they can later be loaded with @ref
+  /// RTMeshModel::loadCache instead of being built again.
+  ///
+  /// @note The model must be committed, with the full node format, before calling this function.
+  ///
+  /// @param path The path of the file to save to.
+  ///
+  /// @param key A value that identifies the source of the model. The result of @ref computeFileVersionKey for the
+  /// source file lets the cache be found before the file is parsed; @ref ObjMeshModel::computeHash works for models
+  /// that have no file.
+  ///
+  /// @return True on success, false on failure.
+  bool saveCache(const char* path, std::uint64_t key) const;
+
+  /// Loads the triangles, attributes and BVH of the model from a file written by @ref RTMeshModel::saveCache. The file
+  /// is mapped into memory and its arrays are copied as they are, without any parsing. The model does not need to be
+  /// committed afterwards.
+  ///
+  /// @param path The path of the file to load.
+  ///
+  /// @param key The key that the file must have been saved with. If it does not match, the file is considered stale.
+  ///
+  /// @return True on success, false if the file could not be opened, is stale, or was written by an incompatible build.
+  bool loadCache(const char* path, std::uint64_t key);
+
   std::optional<AnyHit> findAnyHit(const Ray& ray) const;
 
   std::optional<ClosestHit> findClosestHit(const Ray& ray) const;
 
+  /// Finds any hit for each ray in a contiguous range of rays. The intersector and traverser are set up once per thread
+  /// and reused for the whole range, which is split among the available threads.
+  ///
+  /// @param rays The rays to trace.
+  ///
+  /// @param hits The array to write the results to. It must have room for @p rayCount results.
+  ///
+  /// @param rayCount The number of rays to trace.
+  void findAnyHits(const Ray* rays, std::optional<AnyHit>* hits, std::size_t rayCount) const;
+
+  /// Finds the closest hit for each ray in a contiguous range of rays.
+  ///
+  /// @see RTMeshModel::findAnyHits
+  void findClosestHits(const Ray* rays, std::optional<ClosestHit>* hits, std::size_t rayCount) const;
+
+  /// Finds any hit for a packet of coherent rays, such as the shadow rays leaving a small screen tile.
+  ///
+  /// @tparam LaneCount The number of rays in the packet. A packet of one ray falls back to the single ray traverser.
+  ///
+  /// @param rays The rays of the packet. There must be exactly @p LaneCount rays.
+  ///
+  /// @param hits The array to write the results to. There must be room for exactly @p LaneCount results.
+  template<std::size_t LaneCount = defaultPacketSize<Float>()>
+  void findAnyHitPacket(const Ray* rays, std::optional<AnyHit>* hits) const;
+
+  /// Finds the closest hit for a packet of coherent rays, such as the primary rays of a small screen tile.
+  ///
+  /// @see RTMeshModel::findAnyHitPacket
+  template<std::size_t LaneCount = defaultPacketSize<Float>()>
+  void findClosestHitPacket(const Ray* rays, std::optional<ClosestHit>* hits) const;
+
   const Triangle& getTriangle(size_t index) const noexcept { return m_triangles[index]; }
 
-  const Attrib& getAttrib(size_t index) const noexcept { return m_attribs[index]; }
+  size_t getTriangleCount() const noexcept { return m_triangleCount; }
+
+  /// Gets the bounding box of all the triangles in the model.
+  ///
+  /// @note The model must be committed before calling this function.
+  BoundingBox getBoundingBox() const;
+
+  /// Computes the cost of traversing the BVH, as estimated by the surface area heuristic. Lower is better.
+  ///
+  /// @note The model must be committed, with the full node format, before calling this function.
+  Float computeSahCost() const;
+
+  MemoryReport getMemoryReport() const;
+
+  /// Indicates whether the model has vertex attributes. Models filled by @ref RTMeshModel::updatePositions alone, or
+  /// loaded from a cache without attributes, do not.
+  bool hasAttribs() const noexcept { return m_attribVertexCount != 0; }
+
+  /// Gathers the attributes of a triangle. The attributes are kept apart from the triangles, in one array per
+  /// component that is indexed by vertex, so that they stay out of the way of the traversal and are only read once a
+  /// hit has been found.
+  ///
+  /// @param index The index of the triangle, as found in the primitive index of a hit.
+  Attrib getAttrib(size_t index) const noexcept;
 
 private:
   static std::size_t getTriangleCount(const ObjMeshModel& objMeshModel);
 
+  /// The header at the start of a cache file. It is followed by the triangles, the BVH nodes, the triangle sources, the
+  /// attribute components and the attribute indices, each starting at an offset that is a multiple of @ref
+  /// RTMeshModel::cacheAlignment.
+  struct CacheHeader final
+  {
+    char magic[8];
+
+    std::uint32_t version;
+
+    std::uint32_t triangleSize;
+
+    std::uint32_t floatSize;
+
+    std::uint32_t nodeSize;
+
+    std::uint64_t key;
+
+    std::uint64_t triangleCount;
+
+    /// The number of vertices in each attribute component array, or zero if there are no attributes.
+    std::uint64_t attribVertexCount;
+
+    std::uint64_t nodeCount;
+  };
+
+  /// Must be incremented whenever the layout of the cache file changes.
+  static constexpr std::uint32_t cacheVersion() noexcept { return 3; }
+
+  static constexpr std::size_t cacheAlignment() noexcept { return 64; }
+
+  static constexpr std::size_t alignCacheOffset(std::size_t offset) noexcept
+  {
+    return ((offset + cacheAlignment() - 1) / cacheAlignment()) * cacheAlignment();
+  }
+
+  static CacheHeader makeCacheHeader(std::uint64_t key,
+                                     std::uint64_t triangleCount,
+                                     std::uint64_t attribVertexCount,
+                                     std::uint64_t nodeCount) noexcept;
+
+  /// Checks that the indices stored in a cache file stay within the arrays that they index, so that a corrupt file is
+  /// rejected instead of being read out of bounds during traversal or when fetching attributes.
+  static bool hasValidCacheIndices(const unsigned char* bytes,
+                                   const CacheHeader& header,
+                                   std::size_t nodesOffset,
+                                   std::size_t sourcesOffset,
+                                   std::size_t attribIndicesOffset) noexcept;
+
+  /// The number of attribute components per vertex: three for the normal and two for the texture coordinates.
+  static constexpr int attribComponentCount() noexcept { return 5; }
+
+  /// Allocates the attribute arrays for a number of vertices and three indices per triangle.
+  void allocateAttribs(std::size_t vertexCount);
+
+  /// Copies the attributes of a vertex of a shape.
+  void setAttribVertex(std::size_t vertexIndex, const ObjMeshModel::ShapeView& shapeView, std::size_t shapeVertexIndex);
+
+  /// The vertices of a shape that have distinct attributes. A shape that is not indexed repeats the attributes of a
+  /// vertex at every corner that shares it, and only the distinct ones are stored. The vertices of an indexed shape
+  /// are already shared, so they are stored as they are, and both arrays are left empty.
+  struct ShapeAttribVertices final
+  {
+    /// The number of distinct vertices.
+    std::size_t vertexCount = 0;
+
+    /// The first vertex of the shape with each distinct set of attributes.
+    std::vector<std::uint32_t> sourceVertices;
+
+    /// The distinct vertex that each vertex of the shape maps to, as an index into the source vertices.
+    std::vector<std::uint32_t> remap;
+
+    std::uint32_t getSourceVertex(std::size_t i) const noexcept
+    {
+      return sourceVertices.empty() ? std::uint32_t(i) : sourceVertices[i];
+    }
+
+    std::uint32_t getDistinctVertex(std::size_t v) const noexcept
+    {
+      return remap.empty() ? std::uint32_t(v) : remap[v];
+    }
+  };
+
+  using AttribBits = std::array<std::uint32_t, attribComponentCount()>;
+
+  /// Gets the attributes of a vertex as bits, so that they are compared exactly.
+  static AttribBits getAttribBits(const ObjMeshModel::ShapeView& shapeView, std::size_t v) noexcept;
+
+  static ShapeAttribVertices findDistinctAttribVertices(const ObjMeshModel::ShapeView& shapeView);
+
+  /// Sorts the vertex indices of a shape in parallel, by sorting slices of them on their own and merging the slices.
+  template<typename Less>
+  static void sortInParallel(std::vector<std::uint32_t>& indices, const Less& less);
+
+  /// Copies the triangles, attributes and attribute indices of a shape, which may or may not be indexed.
+  void fillShape(const ObjMeshModel::ShapeView& shapeView,
+                 const ShapeAttribVertices& attribVertices,
+                 std::size_t triangleOffset,
+                 std::size_t vertexOffset);
+
+  /// Batches smaller than this are traced on the calling thread, since the cost of waking up the thread pool outweighs
+  /// the cost of tracing them.
+  static constexpr std::size_t minParallelBatchSize() noexcept { return 256; }
+
+  template<typename Intersector>
+  void traceBatch(const Ray* rays, std::optional<typename Intersector::Result>* hits, std::size_t rayCount) const;
+
+  /// Traces a single ray through either the binary or the wide BVH, depending on the width of the model.
+  template<typename Intersector>
+  std::optional<typename Intersector::Result> trace(const Ray& ray, Intersector& intersector) const;
+
+  /// Builds the tree used by the single ray queries from the binary BVH, according to the width and the node format.
+  /// This must be called whenever the binary BVH changes.
+  void updateTraversalBvh();
+
+  bool hasFullNodes() const noexcept { return m_bvh.node_count != 0; }
+
+  // The node bounds are stored as (min x, max x, min y, max y, min z, max z).
+
+  static BoundingBox getNodeBounds(const typename Bvh::Node& node) noexcept
+  {
+    return BoundingBox(Vec3(node.bounds[0], node.bounds[2], node.bounds[4]),
+                       Vec3(node.bounds[1], node.bounds[3], node.bounds[5]));
+  }
+
+  static void setNodeBounds(typename Bvh::Node& node, const BoundingBox& box) noexcept
+  {
+    for (int axis = 0; axis < 3; axis++) {
+      node.bounds[(axis * 2) + 0] = box.min[axis];
+      node.bounds[(axis * 2) + 1] = box.max[axis];
+    }
+  }
+
+  void resetTriangleSources();
+
+  /// Sorts the nodes by their depth in the tree, so that refitting can process the tree one level at a time.
+  void computeRefitLevels();
+
 private:
   size_t m_triangleCount = 0;
 
   std::unique_ptr<Triangle[]> m_triangles;
 
-  std::unique_ptr<Attrib[]> m_attribs;
+  std::size_t m_attribVertexCount = 0;
+
+  /// The attributes of the vertices, with one array per component: the normal (x, y, z) then the texture coordinates
+  /// (u, v).
+  std::unique_ptr<Float[]> m_attribComponents[attribComponentCount()];
+
+  /// The vertex of each corner of each triangle, in the order the triangles were given to the model. The attributes
+  /// are not permuted when the BVH is built; a triangle is mapped back to its corners through its source index.
+  std::unique_ptr<std::uint32_t[]> m_attribIndices;
+
+  /// The index that each triangle had before the triangles were permuted to match the order of the BVH.
+  std::unique_ptr<std::size_t[]> m_triangleSources;
 
   Bvh m_bvh;
+
+  /// Only used when the width is greater than 2 and the nodes are at full precision.
+  WideBvh m_wideBvh;
+
+  QuantizedBvh16 m_quantizedBvh16;
+
+  QuantizedBvh8 m_quantizedBvh8;
+
+  /// The format requested with @ref RTMeshModel::setNodeFormat.
+  NodeFormat m_nodeFormat = NodeFormat::full;
+
+  /// The format of the tree that the queries traverse, which is the requested format as of the last build.
+  NodeFormat m_builtNodeFormat = NodeFormat::full;
+
+  BoundingBox m_boundingBox = BoundingBox::empty();
+
+  /// The SAH cost of the BVH when it was built, used to decide when refitting is no longer good enough.
+  Float m_builtSahCost = 0;
+
+  /// The node indices, from the deepest level of the tree to the root.
+  std::vector<std::size_t> m_refitOrder;
+
+  /// The offset in @ref RTMeshModel::m_refitOrder at which each level begins, plus one for the end.
+  std::vector<std::size_t> m_refitLevelOffsets;
 };
 
-template<typename Float>
-std::vector<RTMeshModel<Float>>
-RTMeshModel<Float>::fromObjModel(const ObjMeshModel& objMeshModel)
+template<typename Float, std::size_t Width>
+std::vector<RTMeshModel<Float, Width>>
+RTMeshModel<Float, Width>::fromObjModel(const ObjMeshModel& objMeshModel)
 {
-  std::vector<RTMeshModel<Float>> output;
+  std::vector<RTMeshModel<Float, Width>> output;
 
   for (const ObjMeshModel::ShapeView& shapeView : objMeshModel.getShapeViews()) {
 
@@ -82,110 +459,896 @@ RTMeshModel<Float>::fromObjModel(const ObjMeshModel& objMeshModel)
 
     RTMeshModel& rtMeshModel = output.back();
 
-    rtMeshModel.m_triangles.reset(new Triangle[shapeView.vertexCount / 3]);
+    rtMeshModel.m_triangleCount = shapeView.triangleCount();
+
+    rtMeshModel.m_triangles.reset(new Triangle[rtMeshModel.m_triangleCount]);
+
+    rtMeshModel.resetTriangleSources();
+
+    const ShapeAttribVertices attribVertices = findDistinctAttribVertices(shapeView);
+
+    rtMeshModel.allocateAttribs(attribVertices.vertexCount);
+
+    rtMeshModel.fillShape(shapeView, attribVertices, 0, 0);
+  }
+
+  return output;
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::useObjModel(const ObjMeshModel& objMeshModel)
+{
+  m_triangleCount = getTriangleCount(objMeshModel);
+
+  m_triangles.reset(new Triangle[m_triangleCount]);
+
+  resetTriangleSources();
+
+  const std::vector<ObjMeshModel::ShapeView> shapeViews = objMeshModel.getShapeViews();
+
+  std::vector<ShapeAttribVertices> attribVertices(shapeViews.size());
+
+  std::size_t vertexCount = 0;
+
+  for (std::size_t i = 0; i < shapeViews.size(); i++) {
 
-    rtMeshModel.m_attribs.reset(new Attrib[shapeView.vertexCount / 3]);
+    attribVertices[i] = findDistinctAttribVertices(shapeViews[i]);
 
-    rtMeshModel.m_triangleCount = shapeView.vertexCount / 3;
+    vertexCount += attribVertices[i].vertexCount;
+  }
+
+  allocateAttribs(vertexCount);
+
+  size_t triangleOffset = 0;
+
+  size_t vertexOffset = 0;
+
+  for (std::size_t i = 0; i < shapeViews.size(); i++) {
+
+    fillShape(shapeViews[i], attribVertices[i], triangleOffset, vertexOffset);
+
+    triangleOffset += shapeViews[i].triangleCount();
+
+    vertexOffset += attribVertices[i].vertexCount;
+
+    // The remapping is only needed while the shape is filled.
+    attribVertices[i] = ShapeAttribVertices();
+  }
+}
+
+template<typename Float, std::size_t Width>
+auto
+RTMeshModel<Float, Width>::getAttribBits(const ObjMeshModel::ShapeView& shapeView, std::size_t v) noexcept
+  -> AttribBits
+{
+  const float components[attribComponentCount()]{
+    shapeView.nx(v), shapeView.ny(v), shapeView.nz(v), shapeView.tx(v), shapeView.ty(v)
+  };
+
+  AttribBits bits;
+
+  static_assert(sizeof(bits) == sizeof(components));
+
+  std::memcpy(bits.data(), components, sizeof(components));
+
+  return bits;
+}
+
+template<typename Float, std::size_t Width>
+auto
+RTMeshModel<Float, Width>::findDistinctAttribVertices(const ObjMeshModel::ShapeView& shapeView) -> ShapeAttribVertices
+{
+  ShapeAttribVertices attribVertices;
+
+  if (shapeView.isIndexed()) {
+    attribVertices.vertexCount = shapeView.vertexCount;
+    return attribVertices;
+  }
+
+  // The vertices are sorted by their attributes, so that equal ones end up next to each other. Ties are broken by the
+  // vertex index, so that the first vertex of each run is the first one in the shape, and the order is deterministic.
+
+  std::vector<std::uint32_t> order(shapeView.vertexCount);
+
+  for (std::size_t v = 0; v < order.size(); v++)
+    order[v] = std::uint32_t(v);
 
-    for (size_t i = 0; i < shapeView.vertexCount; i += 3) {
+  sortInParallel(order, [&shapeView](std::uint32_t a, std::uint32_t b) {
+    const AttribBits bitsA = getAttribBits(shapeView, a);
+    const AttribBits bitsB = getAttribBits(shapeView, b);
+    return (bitsA < bitsB) || ((bitsA == bitsB) && (a < b));
+  });
 
-      const Vec3 p0(shapeView.px(i + 0), shapeView.py(i + 0), shapeView.pz(i + 0));
-      const Vec3 p1(shapeView.px(i + 1), shapeView.py(i + 1), shapeView.pz(i + 1));
-      const Vec3 p2(shapeView.px(i + 2), shapeView.py(i + 2), shapeView.pz(i + 2));
+  // Mark the start of each run first, in parallel, since comparing the attributes is the expensive part. The remap
+  // holds the marks until the runs are numbered.
 
-      const Vec3 n0(shapeView.nx(i + 0), shapeView.ny(i + 0), shapeView.nz(i + 0));
-      const Vec3 n1(shapeView.nx(i + 1), shapeView.ny(i + 1), shapeView.nz(i + 1));
-      const Vec3 n2(shapeView.nx(i + 2), shapeView.ny(i + 2), shapeView.nz(i + 2));
+  attribVertices.remap.resize(shapeView.vertexCount);
 
-      const Vec2 t0(shapeView.tx(i + 0), shapeView.ty(i + 0));
-      const Vec2 t1(shapeView.tx(i + 1), shapeView.ty(i + 1));
-      const Vec2 t2(shapeView.tx(i + 2), shapeView.ty(i + 2));
+  const std::ptrdiff_t vertexCount = std::ptrdiff_t(order.size());
 
-      rtMeshModel.m_triangles[i / 3] = Triangle(p0, p1, p2);
+#pragma omp parallel for
+  for (std::ptrdiff_t i = 0; i < vertexCount; i++) {
+    const bool runStart = (i == 0) || (getAttribBits(shapeView, order[i - 1]) != getAttribBits(shapeView, order[i]));
+    attribVertices.remap[order[i]] = runStart ? 1 : 0;
+  }
+
+  std::uint32_t distinctCount = 0;
 
-      rtMeshModel.m_attribs[i / 3] = Attrib{ { n0, n1, n2 }, { t0, t1, t2 } };
+  for (const std::uint32_t v : order) {
+
+    if (attribVertices.remap[v]) {
+      attribVertices.sourceVertices.emplace_back(v);
+      distinctCount++;
     }
+
+    attribVertices.remap[v] = distinctCount - 1;
   }
 
-  return output;
+  attribVertices.vertexCount = distinctCount;
+
+  return attribVertices;
 }
 
-template<typename Float>
+template<typename Float, std::size_t Width>
+template<typename Less>
 void
-RTMeshModel<Float>::useObjModel(const ObjMeshModel& objMeshModel)
+RTMeshModel<Float, Width>::sortInParallel(std::vector<std::uint32_t>& indices, const Less& less)
 {
-  m_triangleCount = getTriangleCount(objMeshModel);
+  const std::size_t minSliceSize = 64 * 1024;
 
-  m_triangles.reset(new Triangle[m_triangleCount]);
+  const std::size_t sliceCount = std::max<std::size_t>(1, std::min<std::size_t>(64, indices.size() / minSliceSize));
+
+  auto sliceBegin = [&indices, sliceCount](std::size_t slice) {
+    return indices.begin() + std::ptrdiff_t((indices.size() * std::min(slice, sliceCount)) / sliceCount);
+  };
 
-  size_t triangleIndex = 0;
+#pragma omp parallel for schedule(dynamic, 1)
+  for (std::ptrdiff_t i = 0; i < std::ptrdiff_t(sliceCount); i++)
+    std::sort(sliceBegin(std::size_t(i)), sliceBegin(std::size_t(i) + 1), less);
 
-  for (const ObjMeshModel::ShapeView& shapeView : objMeshModel.getShapeViews()) {
+  // The sorted slices are merged in pairs, with the merges of each round running in parallel.
+
+  for (std::size_t width = 1; width < sliceCount; width *= 2) {
+
+    const std::ptrdiff_t mergeCount = std::ptrdiff_t((sliceCount + (width * 2) - 1) / (width * 2));
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t i = 0; i < mergeCount; i++) {
 
-    for (size_t i = 0; i < shapeView.vertexCount; i += 3) {
+      const std::size_t first = std::size_t(i) * width * 2;
 
-      const Vec3 p0(shapeView.px(i + 0), shapeView.py(i + 0), shapeView.pz(i + 0));
-      const Vec3 p1(shapeView.px(i + 1), shapeView.py(i + 1), shapeView.pz(i + 1));
-      const Vec3 p2(shapeView.px(i + 2), shapeView.py(i + 2), shapeView.pz(i + 2));
+      std::inplace_merge(sliceBegin(first), sliceBegin(first + width), sliceBegin(first + (width * 2)), less);
+    }
+  }
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::fillShape(const ObjMeshModel::ShapeView& shapeView,
+                                     const ShapeAttribVertices& attribVertices,
+                                     std::size_t triangleOffset,
+                                     std::size_t vertexOffset)
+{
+  const std::ptrdiff_t triangleCount = std::ptrdiff_t(shapeView.triangleCount());
+
+#pragma omp parallel for
+  for (std::ptrdiff_t i = 0; i < triangleCount; i++) {
 
-      m_triangles[triangleIndex] = Triangle(p0, p1, p2);
+    const std::size_t triangleIndex = triangleOffset + std::size_t(i);
 
-      triangleIndex++;
+    Vec3 p[3];
+
+    for (std::size_t j = 0; j < 3; j++) {
+
+      const std::size_t v = shapeView.vertexIndex((std::size_t(i) * 3) + j);
+
+      p[j] = Vec3(shapeView.px(v), shapeView.py(v), shapeView.pz(v));
+
+      m_attribIndices[(triangleIndex * 3) + j] = std::uint32_t(vertexOffset + attribVertices.getDistinctVertex(v));
     }
+
+    m_triangles[triangleIndex] = Triangle(p[0], p[1], p[2]);
   }
+
+  const std::ptrdiff_t vertexCount = std::ptrdiff_t(attribVertices.vertexCount);
+
+#pragma omp parallel for
+  for (std::ptrdiff_t i = 0; i < vertexCount; i++)
+    setAttribVertex(vertexOffset + std::size_t(i), shapeView, attribVertices.getSourceVertex(std::size_t(i)));
 }
 
-template<typename Float>
+template<typename Float, std::size_t Width>
 std::size_t
-RTMeshModel<Float>::getTriangleCount(const ObjMeshModel& objMeshModel)
+RTMeshModel<Float, Width>::getTriangleCount(const ObjMeshModel& objMeshModel)
 {
   std::size_t triCount = 0;
 
   for (const ObjMeshModel::ShapeView& shapeView : objMeshModel.getShapeViews())
-    triCount += shapeView.vertexCount / 3;
+    triCount += shapeView.triangleCount();
 
   return triCount;
 }
 
-template<typename Float>
+template<typename Float, std::size_t Width>
 void
-RTMeshModel<Float>::commit()
+RTMeshModel<Float, Width>::commit(BuildQuality quality)
 {
   auto [bboxes, centers] = bvh::compute_bounding_boxes_and_centers(m_triangles.get(), m_triangleCount);
 
   auto global_bbox = bvh::compute_bounding_boxes_union(bboxes.get(), m_triangleCount);
 
-  bvh::SweepSahBuilder<Bvh> builder(m_bvh);
-
-  builder.build(global_bbox, bboxes.get(), centers.get(), m_triangleCount);
+  switch (quality) {
+    case BuildQuality::low: {
+      bvh::LinearBvhBuilder<Bvh, std::uint32_t> builder(m_bvh);
+      builder.build(global_bbox, bboxes.get(), centers.get(), m_triangleCount);
+    } break;
+    case BuildQuality::medium: {
+      bvh::BinnedSahBuilder<Bvh, 16> builder(m_bvh);
+      builder.build(global_bbox, bboxes.get(), centers.get(), m_triangleCount);
+    } break;
+    case BuildQuality::high: {
+      bvh::SweepSahBuilder<Bvh> builder(m_bvh);
+      builder.build(global_bbox, bboxes.get(), centers.get(), m_triangleCount);
+    } break;
+  }
 
   m_triangles = bvh::permute_primitives(m_triangles.get(), m_bvh.primitive_indices.get(), m_triangleCount);
 
-  if (m_attribs)
-    m_attribs = bvh::permute_primitives(m_attribs.get(), m_bvh.primitive_indices.get(), m_triangleCount);
+  m_triangleSources = bvh::permute_primitives(m_triangleSources.get(), m_bvh.primitive_indices.get(), m_triangleCount);
+
+  m_refitOrder.clear();
+
+  m_refitLevelOffsets.clear();
+
+  m_builtSahCost = computeSahCost();
+
+  updateTraversalBvh();
 }
 
-template<typename Float>
+template<typename Float, std::size_t Width>
 auto
-RTMeshModel<Float>::findAnyHit(const Ray& ray) const -> std::optional<AnyHit>
+RTMeshModel<Float, Width>::findAnyHit(const Ray& ray) const -> std::optional<AnyHit>
 {
   AnyIntersector intersector(m_bvh, m_triangles.get());
 
-  Traverser traverser(m_bvh);
-
-  return traverser.traverse(ray, intersector);
+  return trace(ray, intersector);
 }
 
-template<typename Float>
+template<typename Float, std::size_t Width>
 auto
-RTMeshModel<Float>::findClosestHit(const Ray& ray) const -> std::optional<ClosestHit>
+RTMeshModel<Float, Width>::findClosestHit(const Ray& ray) const -> std::optional<ClosestHit>
 {
   ClosestIntersector intersector(m_bvh, m_triangles.get());
 
-  Traverser traverser(m_bvh);
+  return trace(ray, intersector);
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::findAnyHits(const Ray* rays, std::optional<AnyHit>* hits, std::size_t rayCount) const
+{
+  traceBatch<AnyIntersector>(rays, hits, rayCount);
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::findClosestHits(const Ray* rays, std::optional<ClosestHit>* hits, std::size_t rayCount) const
+{
+  traceBatch<ClosestIntersector>(rays, hits, rayCount);
+}
+
+template<typename Float, std::size_t Width>
+template<typename Intersector>
+void
+RTMeshModel<Float, Width>::traceBatch(const Ray* rays,
+                                      std::optional<typename Intersector::Result>* hits,
+                                      std::size_t rayCount) const
+{
+  const std::ptrdiff_t count = std::ptrdiff_t(rayCount);
+
+#pragma omp parallel if (rayCount >= minParallelBatchSize())
+  {
+    Intersector intersector(m_bvh, m_triangles.get());
+
+#pragma omp for schedule(dynamic, 64)
+    for (std::ptrdiff_t i = 0; i < count; i++)
+      hits[i] = trace(rays[i], intersector);
+  }
+}
+
+template<typename Float, std::size_t Width>
+template<typename Intersector>
+std::optional<typename Intersector::Result>
+RTMeshModel<Float, Width>::trace(const Ray& ray, Intersector& intersector) const
+{
+  switch (m_builtNodeFormat) {
+    case NodeFormat::quantized16:
+      return m_quantizedBvh16.traverse(ray, intersector);
+    case NodeFormat::quantized8:
+      return m_quantizedBvh8.traverse(ray, intersector);
+    case NodeFormat::full:
+      break;
+  }
+
+  // The model may not have been committed yet.
+  if (!hasFullNodes())
+    return std::nullopt;
+
+  if constexpr (Width > 2) {
+    return m_wideBvh.traverse(ray, intersector);
+  } else {
+    Traverser traverser(m_bvh);
+    return traverser.traverse(ray, intersector);
+  }
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::updateTraversalBvh()
+{
+  m_boundingBox = m_bvh.node_count ? getNodeBounds(m_bvh.nodes[0]) : BoundingBox::empty();
+
+  m_quantizedBvh16.clear();
+
+  m_quantizedBvh8.clear();
+
+  m_builtNodeFormat = m_nodeFormat;
+
+  if (m_nodeFormat == NodeFormat::full) {
+
+    if constexpr (Width > 2)
+      m_wideBvh.collapse(m_bvh);
+
+    return;
+  }
+
+  // Quantization works on the wide layout, even for a binary tree, and the full precision trees are released once
+  // the quantized one is built.
+
+  m_wideBvh.collapse(m_bvh);
+
+  if (m_nodeFormat == NodeFormat::quantized16)
+    m_quantizedBvh16.quantize(m_wideBvh);
+  else
+    m_quantizedBvh8.quantize(m_wideBvh);
+
+  m_wideBvh.clear();
+
+  m_bvh.nodes.reset();
+
+  m_bvh.node_count = 0;
+
+  m_bvh.primitive_indices.reset();
+
+  m_refitOrder.clear();
+
+  m_refitLevelOffsets.clear();
+}
+
+template<typename Float, std::size_t Width>
+template<std::size_t LaneCount>
+void
+RTMeshModel<Float, Width>::findAnyHitPacket(const Ray* rays, std::optional<AnyHit>* hits) const
+{
+  if constexpr (LaneCount == 1) {
+    hits[0] = findAnyHit(rays[0]);
+  } else if (!hasFullNodes()) {
+    for (std::size_t i = 0; i < LaneCount; i++)
+      hits[i] = findAnyHit(rays[i]);
+  } else {
+    RTPacketTraverser<Float, LaneCount> traverser(m_bvh, m_triangles.get());
+    traverser.template traverse<true>(rays, hits);
+  }
+}
+
+template<typename Float, std::size_t Width>
+template<std::size_t LaneCount>
+void
+RTMeshModel<Float, Width>::findClosestHitPacket(const Ray* rays, std::optional<ClosestHit>* hits) const
+{
+  if constexpr (LaneCount == 1) {
+    hits[0] = findClosestHit(rays[0]);
+  } else if (!hasFullNodes()) {
+    for (std::size_t i = 0; i < LaneCount; i++)
+      hits[i] = findClosestHit(rays[i]);
+  } else {
+    RTPacketTraverser<Float, LaneCount> traverser(m_bvh, m_triangles.get());
+    traverser.template traverse<false>(rays, hits);
+  }
+}
+
+template<typename Float, std::size_t Width>
+auto
+RTMeshModel<Float, Width>::makeCacheHeader(std::uint64_t key,
+                                           std::uint64_t triangleCount,
+                                           std::uint64_t attribVertexCount,
+                                           std::uint64_t nodeCount) noexcept -> CacheHeader
+{
+  CacheHeader header{};
+
+  std::memcpy(header.magic, "AkRTMsh", 8);
+
+  header.version = cacheVersion();
+  header.triangleSize = sizeof(Triangle);
+  header.floatSize = sizeof(Float);
+  header.nodeSize = sizeof(typename Bvh::Node);
+  header.key = key;
+  header.triangleCount = triangleCount;
+  header.attribVertexCount = attribVertexCount;
+  header.nodeCount = nodeCount;
+
+  return header;
+}
+
+template<typename Float, std::size_t Width>
+bool
+RTMeshModel<Float, Width>::hasValidCacheIndices(const unsigned char* bytes,
+                                                const CacheHeader& header,
+                                                std::size_t nodesOffset,
+                                                std::size_t sourcesOffset,
+                                                std::size_t attribIndicesOffset) noexcept
+{
+  const std::uint64_t triangleCount = header.triangleCount;
+
+  const std::uint64_t nodeCount = header.nodeCount;
+
+  if (triangleCount && !nodeCount)
+    return false;
+
+  for (std::uint64_t i = 0; i < nodeCount; i++) {
+
+    typename Bvh::Node node;
+
+    std::memcpy(&node, bytes + nodesOffset + (i * sizeof(node)), sizeof(node));
+
+    const std::uint64_t first = node.first_child_or_primitive;
+
+    if (node.is_leaf()) {
+      if ((first > triangleCount) || (node.primitive_count > (triangleCount - first)))
+        return false;
+    } else if ((first <= i) || (first >= (nodeCount - 1))) {
+      // The children of an inner node come in pairs, after their parent, which the builders always do. This also
+      // rules out cycles, which would make the traversal and the refit loop forever.
+      return false;
+    }
+  }
+
+  for (std::uint64_t i = 0; i < triangleCount; i++) {
+
+    std::size_t source = 0;
+
+    std::memcpy(&source, bytes + sourcesOffset + (i * sizeof(source)), sizeof(source));
+
+    if (source >= triangleCount)
+      return false;
+  }
+
+  if (!header.attribVertexCount)
+    return true;
+
+  for (std::uint64_t i = 0; i < (triangleCount * 3); i++) {
+
+    std::uint32_t attribIndex = 0;
+
+    std::memcpy(&attribIndex, bytes + attribIndicesOffset + (i * sizeof(attribIndex)), sizeof(attribIndex));
+
+    if (attribIndex >= header.attribVertexCount)
+      return false;
+  }
+
+  return true;
+}
+
+template<typename Float, std::size_t Width>
+bool
+RTMeshModel<Float, Width>::saveCache(const char* path, std::uint64_t key) const
+{
+  static_assert(std::is_trivially_copyable_v<Triangle>);
+  static_assert(std::is_trivially_copyable_v<typename Bvh::Node>);
+
+  if (m_triangleCount && !hasFullNodes())
+    return false;
+
+  std::FILE* file = std::fopen(path, "wb");
+  if (!file)
+    return false;
+
+  const CacheHeader header = makeCacheHeader(key, m_triangleCount, m_attribVertexCount, m_bvh.node_count);
+
+  std::size_t offset = 0;
+
+  auto writeSection = [file, &offset](const void* data, std::size_t size) -> bool {
+    const unsigned char padding[cacheAlignment()]{};
+
+    const std::size_t paddingSize = alignCacheOffset(offset) - offset;
+
+    if (std::fwrite(padding, 1, paddingSize, file) != paddingSize)
+      return false;
+
+    if (size && (std::fwrite(data, 1, size, file) != size))
+      return false;
+
+    offset += paddingSize + size;
+
+    return true;
+  };
+
+  bool success = writeSection(&header, sizeof(header));
+
+  success = success && writeSection(m_triangles.get(), m_triangleCount * sizeof(Triangle));
+
+  success = success && writeSection(m_bvh.nodes.get(), m_bvh.node_count * sizeof(typename Bvh::Node));
+
+  success = success && writeSection(m_triangleSources.get(), m_triangleCount * sizeof(std::size_t));
+
+  if (hasAttribs()) {
+
+    for (const std::unique_ptr<Float[]>& component : m_attribComponents)
+      success = success && writeSection(component.get(), m_attribVertexCount * sizeof(Float));
+
+    success = success && writeSection(m_attribIndices.get(), m_triangleCount * 3 * sizeof(std::uint32_t));
+  }
+
+  success = (std::fclose(file) == 0) && success;
+
+  if (!success)
+    std::remove(path);
+
+  return success;
+}
+
+template<typename Float, std::size_t Width>
+bool
+RTMeshModel<Float, Width>::loadCache(const char* path, std::uint64_t key)
+{
+  MappedFile file;
+
+  if (!file.open(path) || (file.size() < sizeof(CacheHeader)))
+    return false;
+
+  const unsigned char* bytes = (const unsigned char*)file.data();
+
+  CacheHeader header;
+
+  std::memcpy(&header, bytes, sizeof(header));
+
+  const CacheHeader expected =
+    makeCacheHeader(key, header.triangleCount, header.attribVertexCount, header.nodeCount);
+
+  if (std::memcmp(&header, &expected, sizeof(header)) != 0)
+    return false;
+
+  // The counts are checked against the size of the file before any offset is computed from them, which also keeps the
+  // offsets from overflowing.
+
+  auto fitsInFile = [&file](std::uint64_t count, std::size_t elementSize) -> bool {
+    return count <= (file.size() / elementSize);
+  };
+
+  const bool countsFit = fitsInFile(header.triangleCount, sizeof(Triangle)) &&
+                         fitsInFile(header.nodeCount, sizeof(typename Bvh::Node)) &&
+                         fitsInFile(header.attribVertexCount, sizeof(Float));
+
+  if (!countsFit)
+    return false;
+
+  const std::size_t trianglesOffset = alignCacheOffset(sizeof(CacheHeader));
+
+  const std::size_t nodesOffset = alignCacheOffset(trianglesOffset + (header.triangleCount * sizeof(Triangle)));
+
+  const std::size_t sourcesOffset = alignCacheOffset(nodesOffset + (header.nodeCount * sizeof(typename Bvh::Node)));
+
+  std::size_t endOffset = sourcesOffset + (header.triangleCount * sizeof(std::size_t));
+
+  std::size_t componentOffsets[attribComponentCount()]{};
+
+  std::size_t attribIndicesOffset = 0;
+
+  if (header.attribVertexCount) {
+
+    for (std::size_t& componentOffset : componentOffsets) {
+      componentOffset = alignCacheOffset(endOffset);
+      endOffset = componentOffset + (header.attribVertexCount * sizeof(Float));
+    }
+
+    attribIndicesOffset = alignCacheOffset(endOffset);
+
+    endOffset = attribIndicesOffset + (header.triangleCount * 3 * sizeof(std::uint32_t));
+  }
+
+  if (file.size() < endOffset)
+    return false;
+
+  if (!hasValidCacheIndices(bytes, header, nodesOffset, sourcesOffset, attribIndicesOffset))
+    return false;
+
+  m_triangleCount = header.triangleCount;
+
+  m_triangles.reset(new Triangle[m_triangleCount]);
+
+  std::memcpy(m_triangles.get(), bytes + trianglesOffset, m_triangleCount * sizeof(Triangle));
+
+  allocateAttribs(header.attribVertexCount);
+
+  if (hasAttribs()) {
+
+    for (int i = 0; i < attribComponentCount(); i++)
+      std::memcpy(m_attribComponents[i].get(), bytes + componentOffsets[i], m_attribVertexCount * sizeof(Float));
+
+    std::memcpy(m_attribIndices.get(), bytes + attribIndicesOffset, m_triangleCount * 3 * sizeof(std::uint32_t));
+  }
+
+  m_bvh.node_count = header.nodeCount;
+
+  m_bvh.nodes.reset(new typename Bvh::Node[m_bvh.node_count]);
+
+  std::memcpy(m_bvh.nodes.get(), bytes + nodesOffset, m_bvh.node_count * sizeof(typename Bvh::Node));
+
+  m_triangleSources.reset(new std::size_t[m_triangleCount]);
+
+  std::memcpy(m_triangleSources.get(), bytes + sourcesOffset, m_triangleCount * sizeof(std::size_t));
+
+  // The triangles in the cache are already permuted, so the primitive indices of the BVH are the identity.
+  m_bvh.primitive_indices.reset(new std::size_t[m_triangleCount]);
+
+  for (std::size_t i = 0; i < m_triangleCount; i++)
+    m_bvh.primitive_indices[i] = i;
+
+  m_refitOrder.clear();
+
+  m_refitLevelOffsets.clear();
+
+  m_builtSahCost = computeSahCost();
+
+  updateTraversalBvh();
+
+  return true;
+}
+
+template<typename Float, std::size_t Width>
+auto
+RTMeshModel<Float, Width>::getBoundingBox() const -> BoundingBox
+{
+  return m_boundingBox;
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::resetTriangleSources()
+{
+  m_triangleSources.reset(new std::size_t[m_triangleCount]);
+
+  for (std::size_t i = 0; i < m_triangleCount; i++)
+    m_triangleSources[i] = i;
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::updatePositions(const Vec3* positions, std::size_t vertexCount)
+{
+  assert(vertexCount == (m_triangleCount * 3));
+
+  (void)vertexCount;
+
+  const std::ptrdiff_t triangleCount = std::ptrdiff_t(m_triangleCount);
+
+#pragma omp parallel for
+  for (std::ptrdiff_t i = 0; i < triangleCount; i++) {
+
+    const Vec3* p = positions + (m_triangleSources[i] * 3);
+
+    m_triangles[i] = Triangle(p[0], p[1], p[2]);
+  }
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::computeRefitLevels()
+{
+  m_refitOrder.clear();
+
+  m_refitLevelOffsets.clear();
+
+  if (!m_bvh.node_count)
+    return;
+
+  // Visit the tree breadth first, which lays the nodes out one level after the other.
+
+  m_refitOrder.reserve(m_bvh.node_count);
+
+  m_refitOrder.emplace_back(0);
+
+  std::size_t levelBegin = 0;
+
+  while (levelBegin < m_refitOrder.size()) {
+
+    const std::size_t levelEnd = m_refitOrder.size();
+
+    m_refitLevelOffsets.emplace_back(levelBegin);
+
+    for (std::size_t i = levelBegin; i < levelEnd; i++) {
+
+      const typename Bvh::Node& node = m_bvh.nodes[m_refitOrder[i]];
+
+      if (!node.is_leaf()) {
+        m_refitOrder.emplace_back(node.first_child_or_primitive);
+        m_refitOrder.emplace_back(node.first_child_or_primitive + 1);
+      }
+    }
+
+    levelBegin = levelEnd;
+  }
+
+  m_refitLevelOffsets.emplace_back(m_refitOrder.size());
+}
+
+template<typename Float, std::size_t Width>
+bool
+RTMeshModel<Float, Width>::refit(Float maxCostRatio, BuildQuality rebuildQuality)
+{
+  if (m_triangleCount && !hasFullNodes()) {
+    commit(rebuildQuality);
+    return false;
+  }
+
+  if (!m_bvh.node_count)
+    return true;
+
+  if (m_refitOrder.empty())
+    computeRefitLevels();
+
+  const std::size_t levelCount = m_refitLevelOffsets.size() - 1;
+
+  for (std::size_t level = levelCount; level > 0; level--) {
+
+    const std::ptrdiff_t levelBegin = std::ptrdiff_t(m_refitLevelOffsets[level - 1]);
+
+    const std::ptrdiff_t levelEnd = std::ptrdiff_t(m_refitLevelOffsets[level]);
+
+#pragma omp parallel for if ((levelEnd - levelBegin) >= 1024)
+    for (std::ptrdiff_t i = levelBegin; i < levelEnd; i++) {
+
+      typename Bvh::Node& node = m_bvh.nodes[m_refitOrder[i]];
+
+      const std::size_t first = node.first_child_or_primitive;
+
+      BoundingBox box = BoundingBox::empty();
+
+      if (node.is_leaf()) {
+        for (std::size_t j = first; j < (first + node.primitive_count); j++)
+          box.extend(m_triangles[j].bounding_box());
+      } else {
+        box = getNodeBounds(m_bvh.nodes[first]);
+        box.extend(getNodeBounds(m_bvh.nodes[first + 1]));
+      }
+
+      setNodeBounds(node, box);
+    }
+  }
+
+  if ((maxCostRatio == Infinity<Float>::value()) || (computeSahCost() <= (m_builtSahCost * maxCostRatio))) {
+    updateTraversalBvh();
+    return true;
+  }
+
+  commit(rebuildQuality);
+
+  return false;
+}
+
+template<typename Float, std::size_t Width>
+Float
+RTMeshModel<Float, Width>::computeSahCost() const
+{
+  if (!m_bvh.node_count)
+    return 0;
+
+  const Float rootArea = getNodeBounds(m_bvh.nodes[0]).half_area();
+
+  if (!(rootArea > 0))
+    return 0;
+
+  // The relative costs of visiting a node and of intersecting a triangle.
+  const Float traversalCost = 1;
+  const Float intersectionCost = 1;
+
+  const std::ptrdiff_t nodeCount = std::ptrdiff_t(m_bvh.node_count);
+
+  Float cost = 0;
+
+#pragma omp parallel for reduction(+ : cost)
+  for (std::ptrdiff_t i = 0; i < nodeCount; i++) {
+
+    const typename Bvh::Node& node = m_bvh.nodes[i];
+
+    const Float area = getNodeBounds(node).half_area();
+
+    cost += node.is_leaf() ? (area * intersectionCost * node.primitive_count) : (area * traversalCost);
+  }
+
+  return cost / rootArea;
+}
+
+template<typename Float, std::size_t Width>
+auto
+RTMeshModel<Float, Width>::getMemoryReport() const -> MemoryReport
+{
+  MemoryReport report;
+
+  report.triangleCount = m_triangleCount;
+
+  report.triangleBytes = m_triangleCount * sizeof(Triangle);
+
+  if (hasAttribs()) {
+    report.attribBytes += m_attribVertexCount * attribComponentCount() * sizeof(Float);
+    report.attribBytes += m_triangleCount * 3 * sizeof(std::uint32_t);
+  }
+
+  report.nodeBytes += m_bvh.node_count * sizeof(typename Bvh::Node);
+
+  report.nodeBytes += m_wideBvh.getNodeCount() * sizeof(typename WideBvh::Node);
+
+  report.nodeBytes += m_quantizedBvh16.getNodeCount() * sizeof(typename QuantizedBvh16::Node);
+
+  report.nodeBytes += m_quantizedBvh8.getNodeCount() * sizeof(typename QuantizedBvh8::Node);
+
+  if (m_bvh.primitive_indices)
+    report.indexBytes += m_triangleCount * sizeof(std::size_t);
+
+  if (m_triangleSources)
+    report.indexBytes += m_triangleCount * sizeof(std::size_t);
+
+  return report;
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::allocateAttribs(std::size_t vertexCount)
+{
+  assert(vertexCount <= std::numeric_limits<std::uint32_t>::max());
+
+  m_attribVertexCount = vertexCount;
+
+  for (std::unique_ptr<Float[]>& component : m_attribComponents)
+    component.reset(vertexCount ? new Float[vertexCount] : nullptr);
+
+  m_attribIndices.reset(vertexCount ? new std::uint32_t[m_triangleCount * 3] : nullptr);
+}
+
+template<typename Float, std::size_t Width>
+void
+RTMeshModel<Float, Width>::setAttribVertex(std::size_t vertexIndex,
+                                           const ObjMeshModel::ShapeView& shapeView,
+                                           std::size_t shapeVertexIndex)
+{
+  m_attribComponents[0][vertexIndex] = shapeView.nx(shapeVertexIndex);
+  m_attribComponents[1][vertexIndex] = shapeView.ny(shapeVertexIndex);
+  m_attribComponents[2][vertexIndex] = shapeView.nz(shapeVertexIndex);
+  m_attribComponents[3][vertexIndex] = shapeView.tx(shapeVertexIndex);
+  m_attribComponents[4][vertexIndex] = shapeView.ty(shapeVertexIndex);
+}
+
+template<typename Float, std::size_t Width>
+auto
+RTMeshModel<Float, Width>::getAttrib(size_t index) const noexcept -> Attrib
+{
+  Attrib attrib;
+
+  const std::size_t source = m_triangleSources[index];
+
+  for (int i = 0; i < 3; i++) {
+
+    const std::uint32_t vertexIndex = m_attribIndices[(source * 3) + i];
+
+    attrib.normals[i] = Vec3(m_attribComponents[0][vertexIndex],
+                             m_attribComponents[1][vertexIndex],
+                             m_attribComponents[2][vertexIndex]);
+
+    attrib.texCoords[i] = Vec2(m_attribComponents[3][vertexIndex], m_attribComponents[4][vertexIndex]);
+  }
 
-  return traverser.traverse(ray, intersector);
+  return attrib;
 }
 
 } // namespace Ak
@@ -0,0 +1,292 @@
+#pragma once
+
+#include <Ak/RTTraversal.h>
+#include <Ak/RTTraversalStack.h>
+
+#include <bvh/bvh.hpp>
+#include <bvh/ray.hpp>
+#include <bvh/triangle.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+
+#include <cstddef>
+#include <cstdint>
+
+namespace Ak {
+
+/// Gets the number of rays per packet that fills one SIMD register of the target.
+///
+/// @tparam Float The floating point type of the rays.
+template<typename Float>
+constexpr std::size_t
+defaultPacketSize() noexcept
+{
+#if defined(__AVX512F__)
+  return 64 / sizeof(Float);
+#elif defined(__AVX__)
+  return 32 / sizeof(Float);
+#else
+  return 16 / sizeof(Float);
+#endif
+}
+
+/// Traverses a BVH with a packet of rays at once. The packet shares one traversal stack, so a node is fetched once for
+/// all of the rays in the packet, and each node is tested against every lane in a loop over fixed size arrays that the
+/// compiler turns into SIMD instructions. This works best for coherent rays, such as primary rays or shadow rays
+/// leaving a small screen tile.
+///
+/// @tparam Float The floating point type of the BVH and the rays.
+///
+/// @tparam LaneCount The number of rays in a packet. This should be a multiple of the SIMD width of the target.
+template<typename Float, std::size_t LaneCount>
+class RTPacketTraverser final
+{
+public:
+  static_assert(LaneCount > 0, "A packet must contain at least one ray.");
+
+  static_assert(LaneCount <= 32, "The active lanes of a packet are tracked in a 32-bit mask.");
+
+  using Bvh = bvh::Bvh<Float>;
+
+  using Ray = bvh::Ray<Float>;
+
+  using Triangle = bvh::Triangle<Float>;
+
+  RTPacketTraverser(const Bvh& bvh, const Triangle* triangles)
+    : m_bvh(bvh)
+    , m_triangles(triangles)
+  {}
+
+  /// Traverses the BVH with a packet of rays.
+  ///
+  /// @note The triangles must be permuted to match the primitive order of the BVH.
+  ///
+  /// @tparam AnyHit Whether or not a lane can stop at the first hit it finds.
+  ///
+  /// @param rays The rays of the packet. There must be exactly @p LaneCount rays.
+  ///
+  /// @param hits The array to write the results to. There must be room for exactly @p LaneCount results.
+  template<bool AnyHit, typename Result>
+  void traverse(const Ray* rays, std::optional<Result>* hits) const;
+
+private:
+  /// The number of stack entries kept in the stack frame, which covers the depth of any balanced tree. Deeper trees
+  /// still work, at the cost of a heap allocation.
+  static constexpr std::size_t stackSize() noexcept { return 64; }
+
+  struct Packet final
+  {
+    alignas(sizeof(Float) * LaneCount) Float origin[3][LaneCount];
+
+    alignas(sizeof(Float) * LaneCount) Float invDir[3][LaneCount];
+
+    alignas(sizeof(Float) * LaneCount) Float tmin[LaneCount];
+
+    alignas(sizeof(Float) * LaneCount) Float tmax[LaneCount];
+  };
+
+  struct StackEntry final
+  {
+    std::size_t nodeIndex;
+
+    std::uint32_t laneMask;
+  };
+
+  /// Tests all lanes of the packet against the bounding box of a node.
+  ///
+  /// @param entry Receives the smallest entry distance among the lanes that hit the box.
+  ///
+  /// @return The mask of lanes, among @p laneMask, that hit the box.
+  static std::uint32_t intersectNode(const typename Bvh::Node& node,
+                                     const Packet& packet,
+                                     std::uint32_t laneMask,
+                                     Float& entry) noexcept;
+
+private:
+  const Bvh& m_bvh;
+
+  const Triangle* m_triangles;
+};
+
+template<typename Float, std::size_t LaneCount>
+std::uint32_t
+RTPacketTraverser<Float, LaneCount>::intersectNode(const typename Bvh::Node& node,
+                                                   const Packet& packet,
+                                                   std::uint32_t laneMask,
+                                                   Float& entry) noexcept
+{
+  // The node bounds are stored as (min x, max x, min y, max y, min z, max z).
+
+  Float tEntry[LaneCount];
+
+  bool hitFlags[LaneCount];
+
+  for (std::size_t i = 0; i < LaneCount; i++) {
+
+    const Float tx0 = (node.bounds[0] - packet.origin[0][i]) * packet.invDir[0][i];
+    const Float tx1 = (node.bounds[1] - packet.origin[0][i]) * packet.invDir[0][i];
+    const Float ty0 = (node.bounds[2] - packet.origin[1][i]) * packet.invDir[1][i];
+    const Float ty1 = (node.bounds[3] - packet.origin[1][i]) * packet.invDir[1][i];
+    const Float tz0 = (node.bounds[4] - packet.origin[2][i]) * packet.invDir[2][i];
+    const Float tz1 = (node.bounds[5] - packet.origin[2][i]) * packet.invDir[2][i];
+
+    const Float tNear =
+      std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), packet.tmin[i]));
+
+    const Float tFar =
+      std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), packet.tmax[i]));
+
+    tEntry[i] = tNear;
+
+    hitFlags[i] = tNear <= tFar;
+  }
+
+  std::uint32_t hitMask = 0;
+
+  entry = std::numeric_limits<Float>::infinity();
+
+  for (std::size_t i = 0; i < LaneCount; i++) {
+    if (hitFlags[i] && (laneMask & (std::uint32_t(1) << i))) {
+      hitMask |= std::uint32_t(1) << i;
+      entry = std::min(entry, tEntry[i]);
+    }
+  }
+
+  return hitMask;
+}
+
+template<typename Float, std::size_t LaneCount>
+template<bool AnyHit, typename Result>
+void
+RTPacketTraverser<Float, LaneCount>::traverse(const Ray* rays, std::optional<Result>* hits) const
+{
+  Packet packet;
+
+  std::uint32_t activeMask = 0;
+
+  for (std::size_t i = 0; i < LaneCount; i++) {
+
+    hits[i].reset();
+
+    for (int axis = 0; axis < 3; axis++) {
+      packet.origin[axis][i] = rays[i].origin[axis];
+      packet.invDir[axis][i] = safeInverse(rays[i].direction[axis]);
+    }
+
+    packet.tmin[i] = rays[i].tmin;
+    packet.tmax[i] = rays[i].tmax;
+
+    if (rays[i].tmin <= rays[i].tmax)
+      activeMask |= std::uint32_t(1) << i;
+  }
+
+  if (!m_bvh.node_count)
+    return;
+
+  Float rootEntry = 0;
+
+  std::uint32_t laneMask = intersectNode(m_bvh.nodes[0], packet, activeMask, rootEntry);
+
+  RTTraversalStack<StackEntry, stackSize()> stack;
+
+  std::size_t nodeIndex = 0;
+
+  while (true) {
+
+    // Lanes that found a hit in an any-hit query drop out of the rest of the traversal.
+    laneMask &= activeMask;
+
+    const typename Bvh::Node& node = m_bvh.nodes[nodeIndex];
+
+    if (laneMask && node.is_leaf()) {
+
+      const std::size_t primitiveBegin = node.first_child_or_primitive;
+
+      const std::size_t primitiveEnd = primitiveBegin + node.primitive_count;
+
+      for (std::size_t primitiveIndex = primitiveBegin; primitiveIndex < primitiveEnd; primitiveIndex++) {
+
+        for (std::size_t i = 0; i < LaneCount; i++) {
+
+          if (!(laneMask & (std::uint32_t(1) << i)))
+            continue;
+
+          Ray ray = rays[i];
+
+          ray.tmax = packet.tmax[i];
+
+          const auto intersection = m_triangles[primitiveIndex].intersect(ray);
+
+          if (!intersection)
+            continue;
+
+          hits[i] = Result{ primitiveIndex, *intersection };
+
+          packet.tmax[i] = intersection->distance();
+
+          if (AnyHit) {
+            activeMask &= ~(std::uint32_t(1) << i);
+            laneMask &= ~(std::uint32_t(1) << i);
+          }
+        }
+
+        if (!laneMask)
+          break;
+      }
+
+      if (AnyHit && !activeMask)
+        return;
+
+      laneMask = 0;
+
+    } else if (laneMask) {
+
+      const std::size_t leftIndex = node.first_child_or_primitive;
+
+      const std::size_t rightIndex = leftIndex + 1;
+
+      Float leftEntry = 0;
+      Float rightEntry = 0;
+
+      const std::uint32_t leftMask = intersectNode(m_bvh.nodes[leftIndex], packet, laneMask, leftEntry);
+
+      const std::uint32_t rightMask = intersectNode(m_bvh.nodes[rightIndex], packet, laneMask, rightEntry);
+
+      if (leftMask && rightMask) {
+
+        const bool leftFirst = leftEntry <= rightEntry;
+
+        stack.push(leftFirst ? StackEntry{ rightIndex, rightMask } : StackEntry{ leftIndex, leftMask });
+
+        nodeIndex = leftFirst ? leftIndex : rightIndex;
+
+        laneMask = leftFirst ? leftMask : rightMask;
+
+        continue;
+
+      } else if (leftMask || rightMask) {
+
+        nodeIndex = leftMask ? leftIndex : rightIndex;
+
+        laneMask = leftMask ? leftMask : rightMask;
+
+        continue;
+      }
+
+      laneMask = 0;
+    }
+
+    if (stack.empty())
+      break;
+
+    const StackEntry top = stack.pop();
+
+    nodeIndex = top.nodeIndex;
+
+    laneMask = top.laneMask;
+  }
+}
+
+} // namespace Ak
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <Ak/RTTraversal.h>
+#include <Ak/RTWideBvh.h>
+
+#include <bvh/ray.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <type_traits>
+#include <vector>
+
+#include <cassert>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace Ak {
+
+/// A compressed version of @ref RTWideBvh, in which the bounds of the children of a node are stored as small integers
+/// relative to the bounds of the node itself. This takes a fraction of the memory of full precision bounds, at the
+/// cost of a few instructions to decode the bounds during traversal and of slightly larger boxes.
+///
+/// The quantized boxes always enclose the original boxes, so a ray that hits a triangle always hits every box on the
+/// path to that triangle, and no hit is ever lost to the rounding.
+///
+/// @tparam Float The floating point type of the BVH and the rays.
+///
+/// @tparam Width The maximum number of children of a node.
+///
+/// @tparam Quantized The unsigned integer type that a bound is stored as, usually 8 or 16 bits.
+template<typename Float, std::size_t Width, typename Quantized>
+class RTQuantizedBvh final
+{
+public:
+  static_assert(std::is_unsigned_v<Quantized>, "Quantized bounds must be stored as unsigned integers.");
+
+  using WideBvh = RTWideBvh<Float, Width>;
+
+  using Ray = bvh::Ray<Float>;
+
+  struct Node final
+  {
+    /// The lower corner of the bounds of the node.
+    Float origin[3];
+
+    /// The size of one quantization step on each axis. This is always a power of two, so that decoding a bound is
+    /// exact up to the final addition.
+    Float scale[3];
+
+    /// The bounds of each child, stored as (min x, max x, min y, max y, min z, max z). A bound is decoded as
+    /// `origin + (q * scale)`. The bounds of an empty slot are inverted.
+    Quantized bounds[6][Width];
+
+    /// For an inner child, the index of its node. For a leaf, the index of its first primitive.
+    std::uint32_t children[Width];
+
+    /// For a leaf, the number of primitives it contains. This is zero for inner children and empty slots.
+    std::uint16_t primitiveCounts[Width];
+  };
+
+  /// Builds the quantized BVH from a wide BVH, keeping its structure and primitive order. The nodes are quantized in
+  /// parallel, since each one only depends on its own children.
+  void quantize(const WideBvh& wideBvh);
+
+  /// Finds a hit along a ray, in the same way as @ref RTWideBvh::traverse.
+  template<typename Intersector>
+  std::optional<typename Intersector::Result> traverse(Ray ray, Intersector& intersector) const;
+
+  std::size_t getNodeCount() const noexcept { return m_nodes.size(); }
+
+  const Node& getNode(std::size_t index) const noexcept { return m_nodes[index]; }
+
+  /// Releases the memory of the nodes.
+  void clear() noexcept { std::vector<Node>().swap(m_nodes); }
+
+private:
+  static constexpr Quantized maxQuantized() noexcept { return std::numeric_limits<Quantized>::max(); }
+
+  static Float decode(Float origin, Float scale, Quantized q) noexcept { return origin + (Float(q) * scale); }
+
+private:
+  std::vector<Node> m_nodes;
+};
+
+template<typename Float, std::size_t Width, typename Quantized>
+void
+RTQuantizedBvh<Float, Width, Quantized>::quantize(const WideBvh& wideBvh)
+{
+  m_nodes.resize(wideBvh.getNodeCount());
+
+  const std::ptrdiff_t nodeCount = std::ptrdiff_t(m_nodes.size());
+
+#pragma omp parallel for
+  for (std::ptrdiff_t i = 0; i < nodeCount; i++) {
+
+    const typename WideBvh::Node& src = wideBvh.getNode(std::size_t(i));
+
+    Node& dst = m_nodes[i];
+
+    bool validFlags[Width];
+
+    for (std::size_t k = 0; k < Width; k++)
+      validFlags[k] = src.bounds[0][k] <= src.bounds[1][k];
+
+    for (int axis = 0; axis < 3; axis++) {
+
+      Float lo = std::numeric_limits<Float>::max();
+      Float hi = -std::numeric_limits<Float>::max();
+
+      for (std::size_t k = 0; k < Width; k++) {
+        if (validFlags[k]) {
+          lo = std::min(lo, src.bounds[(axis * 2) + 0][k]);
+          hi = std::max(hi, src.bounds[(axis * 2) + 1][k]);
+        }
+      }
+
+      // Pick the smallest power of two for which the largest quantized value still reaches the upper bound.
+
+      int exponent = 0;
+
+      std::frexp((hi - lo) / Float(maxQuantized()), &exponent);
+
+      while (decode(lo, std::ldexp(Float(1), exponent), maxQuantized()) < hi)
+        exponent++;
+
+      const Float scale = std::ldexp(Float(1), exponent);
+
+      dst.origin[axis] = lo;
+
+      dst.scale[axis] = scale;
+
+      for (std::size_t k = 0; k < Width; k++) {
+
+        if (!validFlags[k]) {
+          dst.bounds[(axis * 2) + 0][k] = maxQuantized();
+          dst.bounds[(axis * 2) + 1][k] = 0;
+          continue;
+        }
+
+        const Float childLo = src.bounds[(axis * 2) + 0][k];
+        const Float childHi = src.bounds[(axis * 2) + 1][k];
+
+        // Round down the lower bound and up the upper bound, then fix up whatever the floating point rounding of the
+        // division got wrong, by checking against the exact formula used to decode the bounds.
+
+        Float qLo = std::floor((childLo - lo) / scale);
+        Float qHi = std::ceil((childHi - lo) / scale);
+
+        qLo = std::clamp(qLo, Float(0), Float(maxQuantized()));
+        qHi = std::clamp(qHi, Float(0), Float(maxQuantized()));
+
+        Quantized encodedLo = Quantized(qLo);
+        Quantized encodedHi = Quantized(qHi);
+
+        while ((encodedLo > 0) && (decode(lo, scale, encodedLo) > childLo))
+          encodedLo--;
+
+        while ((encodedHi < maxQuantized()) && (decode(lo, scale, encodedHi) < childHi))
+          encodedHi++;
+
+        dst.bounds[(axis * 2) + 0][k] = encodedLo;
+        dst.bounds[(axis * 2) + 1][k] = encodedHi;
+      }
+    }
+
+    for (std::size_t k = 0; k < Width; k++) {
+
+      assert(src.primitiveCounts[k] <= std::numeric_limits<std::uint16_t>::max());
+
+      dst.children[k] = validFlags[k] ? src.children[k] : 0;
+
+      dst.primitiveCounts[k] = validFlags[k] ? std::uint16_t(src.primitiveCounts[k]) : 0;
+    }
+  }
+}
+
+template<typename Float, std::size_t Width, typename Quantized>
+template<typename Intersector>
+std::optional<typename Intersector::Result>
+RTQuantizedBvh<Float, Width, Quantized>::traverse(Ray ray, Intersector& intersector) const
+{
+  // An empty slot has a lower bound above its upper bound, which stays inverted once decoded since the scale is
+  // positive.
+
+  auto decodeBounds = [](const Node& node, std::size_t k, Float* bounds) {
+    for (int i = 0; i < 6; i++)
+      bounds[i] = decode(node.origin[i / 2], node.scale[i / 2], node.bounds[i][k]);
+  };
+
+  return traverseWideBvh<Float, Width>(m_nodes, ray, intersector, decodeBounds);
+}
+
+} // namespace Ak
@@ -0,0 +1,312 @@
+#pragma once
+
+#include <Ak/ObjMeshModel.h>
+#include <Ak/RTMeshModel.h>
+
+#include <bvh/binned_sah_builder.hpp>
+#include <bvh/bvh.hpp>
+#include <bvh/single_ray_traverser.hpp>
+
+#include <glm/glm.hpp>
+
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include <cassert>
+#include <cstddef>
+
+namespace Ak {
+
+/// A two level acceleration structure for scenes made of several meshes. Each mesh has its own BVH (the bottom level),
+/// and the scene builds a BVH over the bounding boxes of the instances of those meshes (the top level). A mesh that is
+/// used by several instances is only stored once, and moving an instance only requires the top level to be rebuilt.
+template<typename Float>
+class RTScene final
+{
+public:
+  using Mesh = RTMeshModel<Float>;
+
+  using Bvh = bvh::Bvh<Float>;
+
+  using BoundingBox = bvh::BoundingBox<Float>;
+
+  using Ray = bvh::Ray<Float>;
+
+  using Vec3 = bvh::Vector3<Float>;
+
+  using Traverser = bvh::SingleRayTraverser<Bvh>;
+
+  using Transform = glm::tmat4x4<Float>;
+
+  struct Instance final
+  {
+    std::size_t meshIndex = 0;
+
+    Transform objectToWorld = Transform(1);
+
+    Transform worldToObject = Transform(1);
+  };
+
+  /// The result of a ray query against the scene.
+  ///
+  /// @note The hit refers to a triangle of the mesh used by the instance, in the object space of that mesh. Normals
+  /// taken from the mesh must be transformed by the inverse transpose of the instance transform.
+  template<typename MeshHit>
+  struct InstanceHit final
+  {
+    std::size_t instanceIndex;
+
+    MeshHit meshHit;
+
+    Float distance() const { return meshHit.distance(); }
+  };
+
+  using ClosestHit = InstanceHit<typename Mesh::ClosestHit>;
+
+  using AnyHit = InstanceHit<typename Mesh::AnyHit>;
+
+  /// Adds a mesh to the scene, which can then be referenced by any number of instances.
+  ///
+  /// @note The mesh must be committed before it is added.
+  ///
+  /// @return The index of the mesh in the scene.
+  std::size_t addMesh(Mesh&& mesh);
+
+  /// Adds an instance of a mesh to the scene.
+  ///
+  /// @note The scene must be committed before the new instance can be hit by rays.
+  ///
+  /// @param meshIndex The index of the mesh, as returned by @ref RTScene::addMesh.
+  ///
+  /// @param objectToWorld The transform from the object space of the mesh to world space.
+  ///
+  /// @return The index of the instance in the scene.
+  std::size_t addInstance(std::size_t meshIndex, const Transform& objectToWorld = Transform(1));
+
+  /// Moves an instance to a new location.
+  ///
+  /// @note The scene must be committed again for the change to take effect. This only rebuilds the top level.
+  void setInstanceTransform(std::size_t instanceIndex, const Transform& objectToWorld);
+
+  /// Adds one mesh per shape of an OBJ model, each with a single instance at the origin.
+  void useObjModel(const ObjMeshModel& objMeshModel);
+
+  /// Builds the top level BVH over the current instances.
+  void commit();
+
+  /// @note Rays do not hit anything until the scene is committed.
+  std::optional<AnyHit> findAnyHit(const Ray& ray) const;
+
+  /// @note Rays do not hit anything until the scene is committed.
+
+  std::optional<ClosestHit> findClosestHit(const Ray& ray) const;
+
+  const Mesh& getMesh(std::size_t meshIndex) const noexcept { return m_meshes[meshIndex]; }
+
+  std::size_t getMeshCount() const noexcept { return m_meshes.size(); }
+
+  const Instance& getInstance(std::size_t instanceIndex) const noexcept { return m_instances[instanceIndex]; }
+
+  std::size_t getInstanceCount() const noexcept { return m_instances.size(); }
+
+private:
+  /// Intersects a ray with the mesh of an instance, after moving the ray into the object space of the instance. The
+  /// direction of the ray is not normalized after the transform, so the distance to a hit is the same in both spaces.
+  template<typename MeshHit, bool IsAnyHit>
+  class InstanceIntersector final
+  {
+  public:
+    using Result = InstanceHit<MeshHit>;
+
+    static constexpr bool any_hit = IsAnyHit;
+
+    InstanceIntersector(const RTScene& scene)
+      : m_scene(scene)
+    {}
+
+    std::optional<Result> intersect(std::size_t index, const Ray& ray) const
+    {
+      const std::size_t instanceIndex = m_scene.m_tlas.primitive_indices[index];
+
+      const Instance& instance = m_scene.m_instances[instanceIndex];
+
+      const Ray objectRay = transformRay(ray, instance.worldToObject);
+
+      const Mesh& mesh = m_scene.m_meshes[instance.meshIndex];
+
+      std::optional<MeshHit> meshHit;
+
+      if constexpr (IsAnyHit)
+        meshHit = mesh.findAnyHit(objectRay);
+      else
+        meshHit = mesh.findClosestHit(objectRay);
+
+      if (!meshHit)
+        return std::nullopt;
+
+      return Result{ instanceIndex, *meshHit };
+    }
+
+  private:
+    const RTScene& m_scene;
+  };
+
+  static Ray transformRay(const Ray& ray, const Transform& transform);
+
+  static BoundingBox transformBoundingBox(const BoundingBox& box, const Transform& transform);
+
+private:
+  std::vector<Mesh> m_meshes;
+
+  std::vector<Instance> m_instances;
+
+  Bvh m_tlas;
+};
+
+template<typename Float>
+std::size_t
+RTScene<Float>::addMesh(Mesh&& mesh)
+{
+  m_meshes.emplace_back(std::move(mesh));
+
+  return m_meshes.size() - 1;
+}
+
+template<typename Float>
+std::size_t
+RTScene<Float>::addInstance(std::size_t meshIndex, const Transform& objectToWorld)
+{
+  assert(meshIndex < m_meshes.size());
+
+  m_instances.emplace_back(Instance{ meshIndex, objectToWorld, glm::inverse(objectToWorld) });
+
+  return m_instances.size() - 1;
+}
+
+template<typename Float>
+void
+RTScene<Float>::setInstanceTransform(std::size_t instanceIndex, const Transform& objectToWorld)
+{
+  Instance& instance = m_instances[instanceIndex];
+
+  instance.objectToWorld = objectToWorld;
+
+  instance.worldToObject = glm::inverse(objectToWorld);
+}
+
+template<typename Float>
+void
+RTScene<Float>::useObjModel(const ObjMeshModel& objMeshModel)
+{
+  for (Mesh& mesh : Mesh::fromObjModel(objMeshModel)) {
+
+    mesh.commit();
+
+    addInstance(addMesh(std::move(mesh)));
+  }
+}
+
+template<typename Float>
+void
+RTScene<Float>::commit()
+{
+  const std::size_t instanceCount = m_instances.size();
+
+  // The builders do not handle an empty set of primitives, and an empty tree is never traversed.
+
+  if (!instanceCount) {
+    m_tlas.nodes.reset();
+    m_tlas.primitive_indices.reset();
+    m_tlas.node_count = 0;
+    return;
+  }
+
+  std::unique_ptr<BoundingBox[]> bboxes(new BoundingBox[instanceCount]);
+
+  std::unique_ptr<Vec3[]> centers(new Vec3[instanceCount]);
+
+  BoundingBox globalBox = BoundingBox::empty();
+
+  for (std::size_t i = 0; i < instanceCount; i++) {
+
+    const Instance& instance = m_instances[i];
+
+    bboxes[i] = transformBoundingBox(m_meshes[instance.meshIndex].getBoundingBox(), instance.objectToWorld);
+
+    centers[i] = bboxes[i].center();
+
+    globalBox.extend(bboxes[i]);
+  }
+
+  // The top level is rebuilt whenever an instance moves, so it favors build speed over traversal speed.
+  bvh::BinnedSahBuilder<Bvh, 16> builder(m_tlas);
+
+  builder.build(globalBox, bboxes.get(), centers.get(), instanceCount);
+}
+
+template<typename Float>
+auto
+RTScene<Float>::findAnyHit(const Ray& ray) const -> std::optional<AnyHit>
+{
+  // The top level only exists once the scene is committed.
+  if (!m_tlas.node_count)
+    return std::nullopt;
+
+  InstanceIntersector<typename Mesh::AnyHit, true> intersector(*this);
+
+  Traverser traverser(m_tlas);
+
+  return traverser.traverse(ray, intersector);
+}
+
+template<typename Float>
+auto
+RTScene<Float>::findClosestHit(const Ray& ray) const -> std::optional<ClosestHit>
+{
+  if (!m_tlas.node_count)
+    return std::nullopt;
+
+  InstanceIntersector<typename Mesh::ClosestHit, false> intersector(*this);
+
+  Traverser traverser(m_tlas);
+
+  return traverser.traverse(ray, intersector);
+}
+
+template<typename Float>
+auto
+RTScene<Float>::transformRay(const Ray& ray, const Transform& transform) -> Ray
+{
+  using Vec4 = glm::tvec4<Float>;
+
+  const Vec4 org = transform * Vec4(ray.origin[0], ray.origin[1], ray.origin[2], Float(1));
+
+  const Vec4 dir = transform * Vec4(ray.direction[0], ray.direction[1], ray.direction[2], Float(0));
+
+  return Ray(Vec3(org.x, org.y, org.z), Vec3(dir.x, dir.y, dir.z), ray.tmin, ray.tmax);
+}
+
+template<typename Float>
+auto
+RTScene<Float>::transformBoundingBox(const BoundingBox& box, const Transform& transform) -> BoundingBox
+{
+  using Vec4 = glm::tvec4<Float>;
+
+  BoundingBox result = BoundingBox::empty();
+
+  for (int i = 0; i < 8; i++) {
+
+    const Float x = (i & 1) ? box.max[0] : box.min[0];
+    const Float y = (i & 2) ? box.max[1] : box.min[1];
+    const Float z = (i & 4) ? box.max[2] : box.min[2];
+
+    const Vec4 corner = transform * Vec4(x, y, z, Float(1));
+
+    result.extend(Vec3(corner.x, corner.y, corner.z));
+  }
+
+  return result;
+}
+
+} // namespace Ak
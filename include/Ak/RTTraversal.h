@@ -0,0 +1,176 @@
+#pragma once
+
+#include <Ak/RTTraversalStack.h>
+
+#include <bvh/ray.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <vector>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace Ak {
+
+/// Inverts a component of a ray direction for the slab test, replacing a zero by a large finite value of the same
+/// sign, so that the slab test never multiplies zero by infinity.
+template<typename Float>
+Float
+safeInverse(Float x) noexcept
+{
+  const Float epsilon = std::numeric_limits<Float>::epsilon();
+
+  if (std::abs(x) <= epsilon)
+    return x >= 0 ? (Float(1) / epsilon) : (Float(-1) / epsilon);
+
+  return Float(1) / x;
+}
+
+/// Finds a hit along a ray in a tree whose nodes have up to @p Width children, in the same way as @ref
+/// bvh::SingleRayTraverser::traverse. This is shared by @ref RTWideBvh and @ref RTQuantizedBvh, which only differ in
+/// how they store the bounds of the children.
+///
+/// @tparam Node A node type with `children` and `primitiveCounts` arrays of @p Width elements, where a non-zero
+/// primitive count marks a leaf.
+///
+/// @param nodes The nodes of the tree, starting with the root.
+///
+/// @param decodeBounds Called as `decodeBounds(node, k, bounds)` to write the bounds of the child `k` of a node into
+/// `Float bounds[6]`, as (min x, max x, min y, max y, min z, max z). The bounds of an empty slot must be inverted. It
+/// is called for every child in a loop without branches, so it should not branch either.
+template<typename Float, std::size_t Width, typename Node, typename DecodeBounds, typename Intersector>
+std::optional<typename Intersector::Result>
+traverseWideBvh(const std::vector<Node>& nodes,
+                bvh::Ray<Float> ray,
+                Intersector& intersector,
+                const DecodeBounds& decodeBounds)
+{
+  using Result = typename Intersector::Result;
+
+  struct StackEntry final
+  {
+    std::uint32_t nodeIndex;
+
+    Float entry;
+  };
+
+  std::optional<Result> bestHit;
+
+  if (nodes.empty())
+    return bestHit;
+
+  Float origin[3];
+
+  Float invDir[3];
+
+  for (int axis = 0; axis < 3; axis++) {
+    origin[axis] = ray.origin[axis];
+    invDir[axis] = safeInverse(ray.direction[axis]);
+  }
+
+  RTTraversalStack<StackEntry, 64 * Width> stack;
+
+  std::uint32_t nodeIndex = 0;
+
+  while (true) {
+
+    const Node& node = nodes[nodeIndex];
+
+    // This loop has no branches, so that all of the children are tested at once.
+
+    Float tEntry[Width];
+
+    bool hitFlags[Width];
+
+    for (std::size_t k = 0; k < Width; k++) {
+
+      Float bounds[6];
+
+      decodeBounds(node, k, bounds);
+
+      Float t[6];
+
+      for (int i = 0; i < 6; i++)
+        t[i] = (bounds[i] - origin[i / 2]) * invDir[i / 2];
+
+      const Float tNear =
+        std::max(std::max(std::min(t[0], t[1]), std::min(t[2], t[3])), std::max(std::min(t[4], t[5]), ray.tmin));
+
+      const Float tFar =
+        std::min(std::min(std::max(t[0], t[1]), std::max(t[2], t[3])), std::min(std::max(t[4], t[5]), ray.tmax));
+
+      tEntry[k] = tNear;
+
+      hitFlags[k] = (tNear <= tFar) && (bounds[0] <= bounds[1]);
+    }
+
+    // The inner children that were hit are sorted from the farthest to the nearest, so that the nearest one ends up
+    // on top of the stack.
+
+    StackEntry innerHits[Width];
+
+    std::size_t innerHitCount = 0;
+
+    for (std::size_t k = 0; k < Width; k++) {
+
+      if (!hitFlags[k])
+        continue;
+
+      const std::size_t primitiveCount = node.primitiveCounts[k];
+
+      if (primitiveCount) {
+
+        const std::size_t primitiveBegin = node.children[k];
+
+        for (std::size_t i = primitiveBegin; i < (primitiveBegin + primitiveCount); i++) {
+
+          if (auto hit = intersector.intersect(i, ray)) {
+
+            bestHit = hit;
+
+            if (Intersector::any_hit)
+              return bestHit;
+
+            ray.tmax = hit->distance();
+          }
+        }
+
+        continue;
+      }
+
+      std::size_t j = innerHitCount++;
+
+      for (; (j > 0) && (innerHits[j - 1].entry < tEntry[k]); j--)
+        innerHits[j] = innerHits[j - 1];
+
+      innerHits[j] = StackEntry{ node.children[k], tEntry[k] };
+    }
+
+    for (std::size_t k = 0; k < innerHitCount; k++)
+      stack.push(innerHits[k]);
+
+    // Children that are now farther than the closest hit found so far are skipped.
+
+    bool found = false;
+
+    while (!stack.empty() && !found) {
+
+      const StackEntry top = stack.pop();
+
+      if (top.entry <= ray.tmax) {
+        nodeIndex = top.nodeIndex;
+        found = true;
+      }
+    }
+
+    if (!found)
+      break;
+  }
+
+  return bestHit;
+}
+
+} // namespace Ak
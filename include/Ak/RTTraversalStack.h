@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include <cstddef>
+
+namespace Ak {
+
+/// The stack of nodes left to visit during a BVH traversal. The first @p InlineSize entries live in the stack frame of
+/// the traversal, which is all that a reasonably balanced tree ever needs. Entries past that spill to the heap, since a
+/// degenerate tree (such as one built over many overlapping triangles) can be arbitrarily deep, and overflowing a fixed
+/// array would silently corrupt memory in release builds.
+///
+/// @tparam Entry The type of the entries, which must be trivially copyable.
+///
+/// @tparam InlineSize The number of entries stored without any allocation.
+template<typename Entry, std::size_t InlineSize>
+class RTTraversalStack final
+{
+public:
+  bool empty() const noexcept { return !m_count; }
+
+  void push(const Entry& entry)
+  {
+    if (m_count < InlineSize)
+      m_entries[m_count] = entry;
+    else
+      m_overflow.emplace_back(entry);
+
+    m_count++;
+  }
+
+  /// @note The stack must not be empty.
+  Entry pop() noexcept
+  {
+    m_count--;
+
+    if (m_count < InlineSize)
+      return m_entries[m_count];
+
+    const Entry entry = m_overflow.back();
+
+    m_overflow.pop_back();
+
+    return entry;
+  }
+
+private:
+  Entry m_entries[InlineSize];
+
+  std::size_t m_count = 0;
+
+  std::vector<Entry> m_overflow;
+};
+
+} // namespace Ak
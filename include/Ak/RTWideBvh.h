@@ -0,0 +1,210 @@
+#pragma once
+
+#include <Ak/RTTraversal.h>
+
+#include <bvh/bvh.hpp>
+#include <bvh/ray.hpp>
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+
+namespace Ak {
+
+/// A BVH in which each node has up to @p Width children, collapsed from a binary BVH. The bounds of the children of a
+/// node are stored as structures of arrays, so that a ray is tested against all of them in a single loop over fixed
+/// size arrays, which the compiler turns into SIMD instructions. Compared to a binary BVH, the tree is shallower and
+/// each node fetched from memory does more work, which reduces the number of cache misses during traversal.
+///
+/// @tparam Float The floating point type of the BVH and the rays.
+///
+/// @tparam Width The maximum number of children of a node. This should match the SIMD width of the target, which is 4
+/// for SSE and 8 for AVX with single precision.
+template<typename Float, std::size_t Width>
+class RTWideBvh final
+{
+public:
+  static_assert(Width >= 2, "A node must have at least two children.");
+
+  using Bvh = bvh::Bvh<Float>;
+
+  using Ray = bvh::Ray<Float>;
+
+  struct Node final
+  {
+    /// The bounds of each child, stored as (min x, max x, min y, max y, min z, max z). The bounds of an empty slot are
+    /// inverted, so that no ray can ever hit them.
+    alignas(sizeof(Float) * Width) Float bounds[6][Width];
+
+    /// For an inner child, the index of its node. For a leaf, the index of its first primitive.
+    std::uint32_t children[Width];
+
+    /// For a leaf, the number of primitives it contains. This is zero for inner children and empty slots.
+    std::uint32_t primitiveCounts[Width];
+  };
+
+  /// Builds the wide BVH from a binary BVH. The primitives of the leaves are not moved, so the wide BVH uses the same
+  /// primitive order as the binary BVH. The inner nodes are collapsed by repeatedly opening the child with the largest
+  /// surface area, until the node is full or only leaves are left.
+  void collapse(const Bvh& binaryBvh);
+
+  /// Finds a hit along a ray, in the same way as @ref bvh::SingleRayTraverser::traverse.
+  ///
+  /// @param ray The ray to trace.
+  ///
+  /// @param intersector The primitive intersector, which decides whether the closest hit or any hit is reported.
+  template<typename Intersector>
+  std::optional<typename Intersector::Result> traverse(Ray ray, Intersector& intersector) const;
+
+  std::size_t getNodeCount() const noexcept { return m_nodes.size(); }
+
+  const Node& getNode(std::size_t index) const noexcept { return m_nodes[index]; }
+
+  /// Releases the memory of the nodes.
+  void clear() noexcept { std::vector<Node>().swap(m_nodes); }
+
+private:
+  static Node makeEmptyNode() noexcept;
+
+private:
+  std::vector<Node> m_nodes;
+};
+
+template<typename Float, std::size_t Width>
+auto
+RTWideBvh<Float, Width>::makeEmptyNode() noexcept -> Node
+{
+  Node node;
+
+  for (std::size_t k = 0; k < Width; k++) {
+
+    for (int axis = 0; axis < 3; axis++) {
+      node.bounds[(axis * 2) + 0][k] = std::numeric_limits<Float>::max();
+      node.bounds[(axis * 2) + 1][k] = -std::numeric_limits<Float>::max();
+    }
+
+    node.children[k] = 0;
+
+    node.primitiveCounts[k] = 0;
+  }
+
+  return node;
+}
+
+template<typename Float, std::size_t Width>
+void
+RTWideBvh<Float, Width>::collapse(const Bvh& binaryBvh)
+{
+  m_nodes.clear();
+
+  if (!binaryBvh.node_count)
+    return;
+
+  assert(binaryBvh.node_count <= std::numeric_limits<std::uint32_t>::max());
+
+  auto halfArea = [&binaryBvh](std::size_t index) -> Float {
+    const Float* b = binaryBvh.nodes[index].bounds;
+    const Float dx = b[1] - b[0];
+    const Float dy = b[3] - b[2];
+    const Float dz = b[5] - b[4];
+    return ((dx + dy) * dz) + (dx * dy);
+  };
+
+  m_nodes.reserve(binaryBvh.node_count / (Width - 1) + 1);
+
+  m_nodes.emplace_back(makeEmptyNode());
+
+  // Pairs of binary node and the wide node that it is collapsed into.
+  std::vector<std::pair<std::size_t, std::uint32_t>> pending;
+
+  pending.emplace_back(0, 0);
+
+  while (!pending.empty()) {
+
+    const auto [binaryIndex, wideIndex] = pending.back();
+
+    pending.pop_back();
+
+    std::size_t candidates[Width];
+
+    std::size_t candidateCount = 0;
+
+    const typename Bvh::Node& binaryNode = binaryBvh.nodes[binaryIndex];
+
+    if (binaryNode.is_leaf()) {
+      // Only the root can be a leaf here, in which case the wide root has a single child.
+      candidates[candidateCount++] = binaryIndex;
+    } else {
+      candidates[candidateCount++] = binaryNode.first_child_or_primitive;
+      candidates[candidateCount++] = binaryNode.first_child_or_primitive + 1;
+    }
+
+    while (candidateCount < Width) {
+
+      std::size_t largest = candidateCount;
+
+      for (std::size_t k = 0; k < candidateCount; k++) {
+
+        if (binaryBvh.nodes[candidates[k]].is_leaf())
+          continue;
+
+        if ((largest == candidateCount) || (halfArea(candidates[k]) > halfArea(candidates[largest])))
+          largest = k;
+      }
+
+      if (largest == candidateCount)
+        break;
+
+      const std::size_t firstChild = binaryBvh.nodes[candidates[largest]].first_child_or_primitive;
+
+      candidates[largest] = firstChild;
+
+      candidates[candidateCount++] = firstChild + 1;
+    }
+
+    for (std::size_t k = 0; k < candidateCount; k++) {
+
+      const typename Bvh::Node& child = binaryBvh.nodes[candidates[k]];
+
+      // The node is looked up again each time, since adding a node may reallocate the array.
+
+      for (int i = 0; i < 6; i++)
+        m_nodes[wideIndex].bounds[i][k] = child.bounds[i];
+
+      if (child.is_leaf()) {
+        m_nodes[wideIndex].children[k] = std::uint32_t(child.first_child_or_primitive);
+        m_nodes[wideIndex].primitiveCounts[k] = std::uint32_t(child.primitive_count);
+        continue;
+      }
+
+      const std::uint32_t childIndex = std::uint32_t(m_nodes.size());
+
+      m_nodes.emplace_back(makeEmptyNode());
+
+      m_nodes[wideIndex].children[k] = childIndex;
+
+      pending.emplace_back(candidates[k], childIndex);
+    }
+  }
+}
+
+template<typename Float, std::size_t Width>
+template<typename Intersector>
+std::optional<typename Intersector::Result>
+RTWideBvh<Float, Width>::traverse(Ray ray, Intersector& intersector) const
+{
+  auto decodeBounds = [](const Node& node, std::size_t k, Float* bounds) {
+    for (int i = 0; i < 6; i++)
+      bounds[i] = node.bounds[i][k];
+  };
+
+  return traverseWideBvh<Float, Width>(m_nodes, ray, intersector, decodeBounds);
+}
+
+} // namespace Ak
@@ -2,22 +2,43 @@
 
 layout(location = 0) uniform mat4 mvp = mat4(1.0);
 
+// Applied to the positions before the instance transform, which is how packed positions are mapped to the bounding
+// box of their shape when the mesh is instanced.
+layout(location = 1) uniform mat4 positionTransform = mat4(1.0);
+
 layout(location = 0) in vec3 position;
 
 layout(location = 1) in vec3 normal;
 
 layout(location = 2) in vec2 texCoords;
 
+// The translation (xyz) and uniform scale (w) of the instance. When the attribute is not enabled, it reads as
+// (0, 0, 0, 1), which leaves the mesh as it is.
+layout(location = 3) in vec4 instanceOffsetScale;
+
+// The rotation of the instance, as a unit quaternion. When the attribute is not enabled, it reads as the identity.
+layout(location = 4) in vec4 instanceRotation;
+
 layout(location = 0) out vec4 normalDepthFromVertShader;
 
 layout(location = 1) out vec2 texCoordsFromVertShader;
 
+vec3
+rotate(vec4 q, vec3 v)
+{
+  return v + (2.0 * cross(q.xyz, cross(q.xyz, v) + (q.w * v)));
+}
+
 void
 main()
 {
-  const vec4 p = mvp * vec4(position, 1.0);
+  const vec3 objectPosition = (positionTransform * vec4(position, 1.0)).xyz;
+
+  const vec3 worldPosition = rotate(instanceRotation, objectPosition * instanceOffsetScale.w) + instanceOffsetScale.xyz;
+
+  const vec4 p = mvp * vec4(worldPosition, 1.0);
 
-  const vec3 n = (normal + 1.0) * 0.5;
+  const vec3 n = (rotate(instanceRotation, normal) + 1.0) * 0.5;
 
   normalDepthFromVertShader = vec4(n, p.z);
 
@@ -6,6 +6,10 @@ layout(location = 0) in vec3 position;
 
 layout(location = 1) in vec4 pointColor;
 
+// The translation (xyz) and uniform scale (w) of the instance. When the attribute is not enabled, it reads as
+// (0, 0, 0, 1), which leaves the points as they are.
+layout(location = 2) in vec4 instanceOffsetScale;
+
 layout(location = 0) out vec4 fragColor;
 
 void
@@ -13,5 +17,5 @@ main()
 {
   fragColor = pointColor;
 
-  gl_Position = mvp * vec4(position, 1.0);
+  gl_Position = mvp * vec4((position * instanceOffsetScale.w) + instanceOffsetScale.xyz, 1.0);
 }
@@ -0,0 +1,134 @@
+#include <Ak/AsyncObjMeshLoader.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace Ak {
+
+AsyncObjMeshLoader::~AsyncObjMeshLoader()
+{
+  cancel();
+}
+
+void
+AsyncObjMeshLoader::start(const char* path, std::size_t batchBudget)
+{
+  cancel();
+
+  m_cancelFlag = false;
+
+  m_state = State::loading;
+
+  m_thread = std::thread(&AsyncObjMeshLoader::load, this, std::string(path), batchBudget);
+}
+
+void
+AsyncObjMeshLoader::cancel()
+{
+  m_cancelFlag = true;
+
+  if (m_thread.joinable())
+    m_thread.join();
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  m_batches.clear();
+
+  m_objMeshModel = ObjMeshModel();
+
+  m_modelTaken = false;
+
+  m_state = State::idle;
+}
+
+auto
+AsyncObjMeshLoader::takeBatches() -> std::vector<Batch>
+{
+  std::vector<Batch> batches;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  batches.swap(m_batches);
+
+  return batches;
+}
+
+bool
+AsyncObjMeshLoader::takeModel(ObjMeshModel& objMeshModel)
+{
+  if (m_state != State::finished)
+    return false;
+
+  std::lock_guard<std::mutex> lock(m_mutex);
+
+  if (m_modelTaken)
+    return false;
+
+  objMeshModel = std::move(m_objMeshModel);
+
+  m_modelTaken = true;
+
+  return true;
+}
+
+void
+AsyncObjMeshLoader::load(std::string path, std::size_t batchBudget)
+{
+  // The batches of each material are kept, so that the model ends up with one shape per material, in the same order
+  // as ObjMeshModel::loadFile. They share their vertices with the queued batches, so nothing is copied until then.
+
+  std::map<int, std::vector<Batch>> materialBatches;
+
+  auto callback = [this, &materialBatches](const ObjMeshModel::ShapeView& shapeView, int materialId) -> bool {
+    const float* begin = shapeView.vertexBuffer;
+
+    const float* end = begin + (shapeView.vertexCount * 8);
+
+    const Batch batch{ materialId, *shapeView.material, std::make_shared<const std::vector<float>>(begin, end) };
+
+    materialBatches[materialId].emplace_back(batch);
+
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+
+      m_batches.emplace_back(batch);
+    }
+
+    return !m_cancelFlag;
+  };
+
+  if (!ObjMeshModel::streamFile(path.c_str(), batchBudget, callback)) {
+    m_state = m_cancelFlag ? State::idle : State::failed;
+    return;
+  }
+
+  ObjMeshModel objMeshModel;
+
+  for (auto& [materialId, batches] : materialBatches) {
+
+    std::size_t floatCount = 0;
+
+    for (const Batch& batch : batches)
+      floatCount += batch.vertices->size();
+
+    // The batches are written straight into the model, and each one is released as soon as it is written, which frees
+    // its vertices if it was already taken and dropped.
+
+    float* vertices = objMeshModel.addShape(batches.front().material, floatCount / 8);
+
+    for (Batch& batch : batches) {
+      vertices = std::copy(batch.vertices->begin(), batch.vertices->end(), vertices);
+      batch.vertices.reset();
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    m_objMeshModel = std::move(objMeshModel);
+  }
+
+  m_state = State::finished;
+}
+
+} // namespace Ak
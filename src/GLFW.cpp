@@ -1,5 +1,7 @@
 #include <Ak/GLFW.h>
 
+#include <Ak/OpenGLStateCache.h>
+
 #include <cassert>
 #include <cstdio>
 #include <cstdlib>
@@ -178,6 +180,9 @@ GLFWWindow::makeCurrent()
 
   glfwMakeContextCurrent(m_self);
 
+  // The cache of this thread describes the context that was current before.
+  OpenGLStateCache::current().invalidate();
+
   return true;
 }
 
@@ -191,6 +196,8 @@ GLFWWindow::doneCurrent()
 
   glfwMakeContextCurrent(nullptr);
 
+  OpenGLStateCache::current().invalidate();
+
   return true;
 }
 
@@ -0,0 +1,236 @@
+#include <Ak/MappedFile.h>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <utility>
+
+#include <cstring>
+
+namespace Ak {
+
+namespace {
+
+std::uint64_t
+fnv1a(std::uint64_t hash, const void* data, std::size_t size) noexcept
+{
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+
+  for (std::size_t i = 0; i < size; i++) {
+    hash ^= bytes[i];
+    hash *= 0x100000001b3ull;
+  }
+
+  return hash;
+}
+
+std::uint64_t
+makeFileVersionKey(const char* path, std::uint64_t size, std::uint64_t modificationTime) noexcept
+{
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+
+  hash = fnv1a(hash, path, std::strlen(path));
+
+  hash = fnv1a(hash, &size, sizeof(size));
+
+  hash = fnv1a(hash, &modificationTime, sizeof(modificationTime));
+
+  // Zero is kept to report a missing file.
+  return hash ? hash : 1;
+}
+
+} // namespace
+
+MappedFile::MappedFile(MappedFile&& other)
+  : m_data(other.m_data)
+  , m_size(other.m_size)
+#ifdef _WIN32
+  , m_fileHandle(other.m_fileHandle)
+  , m_mappingHandle(other.m_mappingHandle)
+#endif
+{
+  other.m_data = nullptr;
+  other.m_size = 0;
+#ifdef _WIN32
+  other.m_fileHandle = nullptr;
+  other.m_mappingHandle = nullptr;
+#endif
+}
+
+MappedFile&
+MappedFile::operator=(MappedFile&& other)
+{
+  if (this == &other)
+    return *this;
+
+  close();
+
+  std::swap(m_data, other.m_data);
+  std::swap(m_size, other.m_size);
+#ifdef _WIN32
+  std::swap(m_fileHandle, other.m_fileHandle);
+  std::swap(m_mappingHandle, other.m_mappingHandle);
+#endif
+
+  return *this;
+}
+
+MappedFile::~MappedFile()
+{
+  close();
+}
+
+#ifdef _WIN32
+
+bool
+MappedFile::open(const char* path)
+{
+  close();
+
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+
+  if (file == INVALID_HANDLE_VALUE)
+    return false;
+
+  LARGE_INTEGER fileSize;
+
+  if (!GetFileSizeEx(file, &fileSize) || (fileSize.QuadPart == 0)) {
+    CloseHandle(file);
+    return false;
+  }
+
+  HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+
+  if (!mapping) {
+    CloseHandle(file);
+    return false;
+  }
+
+  void* data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+
+  if (!data) {
+    CloseHandle(mapping);
+    CloseHandle(file);
+    return false;
+  }
+
+  m_data = data;
+  m_size = std::size_t(fileSize.QuadPart);
+  m_fileHandle = file;
+  m_mappingHandle = mapping;
+
+  return true;
+}
+
+void
+MappedFile::close()
+{
+  if (m_data)
+    UnmapViewOfFile(m_data);
+
+  if (m_mappingHandle)
+    CloseHandle(m_mappingHandle);
+
+  if (m_fileHandle)
+    CloseHandle(m_fileHandle);
+
+  m_data = nullptr;
+  m_size = 0;
+  m_fileHandle = nullptr;
+  m_mappingHandle = nullptr;
+}
+
+std::uint64_t
+computeFileVersionKey(const char* path)
+{
+  WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+  if (!GetFileAttributesExA(path, GetFileExInfoStandard, &attributes))
+    return 0;
+
+  const std::uint64_t size = (std::uint64_t(attributes.nFileSizeHigh) << 32) | attributes.nFileSizeLow;
+
+  const FILETIME& writeTime = attributes.ftLastWriteTime;
+
+  const std::uint64_t modificationTime = (std::uint64_t(writeTime.dwHighDateTime) << 32) | writeTime.dwLowDateTime;
+
+  return makeFileVersionKey(path, size, modificationTime);
+}
+
+#else
+
+bool
+MappedFile::open(const char* path)
+{
+  close();
+
+  const int fd = ::open(path, O_RDONLY);
+
+  if (fd < 0)
+    return false;
+
+  struct stat fileStat;
+
+  if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size <= 0)) {
+    ::close(fd);
+    return false;
+  }
+
+  void* data = mmap(nullptr, std::size_t(fileStat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+
+  // The mapping keeps its own reference to the file, so the descriptor is no longer needed.
+  ::close(fd);
+
+  if (data == MAP_FAILED)
+    return false;
+
+  m_data = data;
+  m_size = std::size_t(fileStat.st_size);
+
+  return true;
+}
+
+void
+MappedFile::close()
+{
+  if (m_data)
+    munmap(m_data, m_size);
+
+  m_data = nullptr;
+  m_size = 0;
+}
+
+std::uint64_t
+computeFileVersionKey(const char* path)
+{
+  struct stat fileStat;
+
+  if (stat(path, &fileStat) != 0)
+    return 0;
+
+  // The nanoseconds matter, since a file rewritten within a second at the same size would otherwise keep its key.
+
+#ifdef __APPLE__
+  const struct timespec& writeTime = fileStat.st_mtimespec;
+#else
+  const struct timespec& writeTime = fileStat.st_mtim;
+#endif
+
+  const std::uint64_t modificationTime =
+    (std::uint64_t(writeTime.tv_sec) * 1'000'000'000ull) + std::uint64_t(writeTime.tv_nsec);
+
+  return makeFileVersionKey(path, std::uint64_t(fileStat.st_size), modificationTime);
+}
+
+#endif
+
+} // namespace Ak
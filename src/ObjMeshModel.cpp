@@ -1,12 +1,29 @@
 #include <Ak/ObjMeshModel.h>
 
+#include <Ak/MappedFile.h>
+
 #include <glm/glm.hpp>
 
 #include <tiny_obj_loader.h>
 
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <limits>
 #include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
 
+#include <cassert>
+#include <cctype>
+#include <cmath>
 #include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 
 namespace Ak {
 
@@ -19,149 +36,1841 @@ struct Vertex final
   glm::vec2 texCoords;
 };
 
-/// Contains the supported (not all) material attributes from OBJ models.
-struct Material final
-{
-  glm::vec3 albedo;
-
-  glm::vec3 emission;
-};
+using Material = ObjMeshModel::Material;
 
 struct Shape final
 {
   Material material;
 
   std::vector<Vertex> vertices;
+
+  /// Only used when the model is loaded in indexed mode.
+  std::vector<std::uint32_t> indices;
 };
 
-bool
-isGoodIndex(const tinyobj::index_t& idx)
+/// Identifies a unique vertex of an OBJ file, by the indices of its position, normal and texture coordinates.
+struct VertexKey final
+{
+  int vertexIndex;
+
+  int normalIndex;
+
+  int texCoordIndex;
+
+  bool operator==(const VertexKey& other) const noexcept
+  {
+    return (vertexIndex == other.vertexIndex) && (normalIndex == other.normalIndex) &&
+           (texCoordIndex == other.texCoordIndex);
+  }
+};
+
+struct VertexKeyHash final
+{
+  std::size_t operator()(const VertexKey& key) const noexcept
+  {
+    std::uint64_t hash = std::uint64_t(std::uint32_t(key.vertexIndex));
+
+    hash = (hash * 0x9e3779b97f4a7c15ull) ^ std::uint32_t(key.normalIndex);
+
+    hash = (hash * 0x9e3779b97f4a7c15ull) ^ std::uint32_t(key.texCoordIndex);
+
+    return std::size_t(hash ^ (hash >> 32));
+  }
+};
+
+/// Mixes a 64-bit word into an FNV-1a hash. Hashing a word at a time instead of a byte at a time keeps the hash fast
+/// enough for large models, at the cost of not matching the standard byte-wise FNV-1a.
+constexpr std::uint64_t
+fnv1a(std::uint64_t hash, std::uint64_t word) noexcept
 {
-  return (idx.vertex_index != -1) && (idx.normal_index != -1) && (idx.texcoord_index != -1);
+  return (hash ^ word) * 0x100000001b3ull;
 }
 
-} // namespace
+/// The header at the start of a binary mesh file. It is followed by one @ref BinaryShapeEntry per shape, then by the
+/// vertex and index buffers of the shapes.
+struct BinaryHeader final
+{
+  char magic[8];
 
-class ObjMeshModelImpl final
+  std::uint32_t version;
+
+  std::uint32_t vertexSize;
+
+  std::uint64_t shapeCount;
+};
+
+struct BinaryShapeEntry final
 {
-  friend ObjMeshModel;
+  /// The offsets are in bytes, from the start of the file.
+  std::uint64_t vertexOffset;
 
-  std::vector<Shape> m_shapes;
+  std::uint64_t vertexCount;
+
+  std::uint64_t indexOffset;
+
+  /// Zero if the shape is not indexed.
+  std::uint64_t indexCount;
+
+  float albedo[3];
+
+  float emission[3];
+
+  /// The strings of the material, which are its name and its albedo, emission and normal texture paths, in that order
+  /// and each one followed by a null character. The texture paths are relative to the directory of the file.
+  std::uint64_t stringOffset;
+
+  std::uint64_t stringSize;
 };
 
-ObjMeshModel::ObjMeshModel()
-  : m_impl(new ObjMeshModelImpl())
-{}
+/// Must be incremented whenever the layout of the binary file changes.
+constexpr std::uint32_t binaryVersion = 3;
 
-ObjMeshModel::ObjMeshModel(ObjMeshModel&& other)
-  : m_impl(other.m_impl)
+constexpr std::size_t binaryAlignment = 64;
+
+constexpr std::size_t
+alignBinaryOffset(std::size_t offset) noexcept
 {
-  other.m_impl = nullptr;
+  return ((offset + binaryAlignment - 1) / binaryAlignment) * binaryAlignment;
 }
 
-ObjMeshModel::~ObjMeshModel()
+/// Gets the strings of a material, in the order they are stored in a binary file.
+std::array<std::string*, 4>
+getMaterialStrings(Material& material) noexcept
 {
-  delete m_impl;
+  return { &material.name, &material.albedoTexture, &material.emissionTexture, &material.normalTexture };
 }
 
-bool
-ObjMeshModel::loadFile(const char* path)
+std::array<std::string*, 3>
+getMaterialTexturePaths(Material& material) noexcept
 {
-  if (!m_impl)
-    m_impl = new ObjMeshModelImpl();
+  return { &material.albedoTexture, &material.emissionTexture, &material.normalTexture };
+}
 
-  tinyobj::ObjReader objReader;
+BinaryHeader
+makeBinaryHeader(std::uint64_t shapeCount) noexcept
+{
+  BinaryHeader header{};
 
-  if (!objReader.ParseFromFile(path))
-    return false;
+  std::memcpy(header.magic, "AkMesh", 7);
 
-  const tinyobj::attrib_t& attrib = objReader.GetAttrib();
+  header.version = binaryVersion;
+  header.vertexSize = sizeof(Vertex);
+  header.shapeCount = shapeCount;
 
-  const float* vertices = attrib.vertices.data();
+  return header;
+}
 
-  const float* normals = attrib.normals.data();
+/// Marks a face corner without a normal or texture coordinate, or with an invalid index.
+constexpr int missingObjIndex = -0x7fffffff - 1;
 
-  const float* texCoords = attrib.texcoords.data();
+/// Relative indices are stored with this subtracted, so that they can be told apart from absolute indices.
+constexpr std::int64_t relativeObjIndexBias = std::int64_t(1) << 30;
 
-  auto getPos = [vertices](const tinyobj::index_t& index) -> glm::vec3 {
-    const int a = (index.vertex_index * 3) + 0;
-    const int b = (index.vertex_index * 3) + 1;
-    const int c = (index.vertex_index * 3) + 2;
-    return glm::vec3(vertices[a], vertices[b], vertices[c]);
-  };
+/// The contents of a line aligned chunk of an OBJ file. Chunks are parsed independently of each other, so anything
+/// that depends on the lines before the chunk is left unresolved until all of the chunks are parsed:
+///
+///   - Absolute (positive) indices are stored zero based. Relative (negative) indices are turned into an index from the
+///     start of the chunk, which is negative if it points into a previous chunk, and stored minus @ref
+///     relativeObjIndexBias.
+///
+///   - A material of -1 refers to the material that is in use at the end of the previous chunk.
+struct ObjChunk final
+{
+  std::vector<float> positions;
 
-  auto getNormal = [normals](const tinyobj::index_t& index) -> glm::vec3 {
-    const int a = (index.normal_index * 3) + 0;
-    const int b = (index.normal_index * 3) + 1;
-    const int c = (index.normal_index * 3) + 2;
-    return glm::vec3(normals[a], normals[b], normals[c]);
-  };
+  std::vector<float> normals;
 
-  auto getTexCoord = [texCoords](const tinyobj::index_t& index) -> glm::vec2 {
-    const int a = (index.texcoord_index * 2) + 0;
-    const int b = (index.texcoord_index * 2) + 1;
-    return glm::vec2(texCoords[a], texCoords[b]);
-  };
+  std::vector<float> texCoords;
 
-  std::map<int, Shape> shapeMap;
+  /// Three corners per triangle, each made of a position, normal and texture coordinate index.
+  std::vector<VertexKey> corners;
 
-  // TODO : copy materials and textures
+  /// The material of each triangle, as an index into @ref ObjChunk::materialNames until it is resolved.
+  std::vector<int> triangleMaterials;
 
-  for (const tinyobj::shape_t& shape : objReader.GetShapes()) {
+  /// The first of the two triangles of each quad. Quads are split along their shortest diagonal, which is only known
+  /// once the indices are resolved.
+  std::vector<std::size_t> quads;
 
-    if ((shape.mesh.material_ids.size() * 3) != shape.mesh.indices.size()) {
-      assert(false);
-      return false;
+  std::vector<std::string> materialNames;
+
+  std::vector<std::string> materialLibraries;
+
+  /// The number of triangles per material, once the materials are resolved.
+  std::vector<std::size_t> materialTriangleCounts;
+
+  bool ok = true;
+};
+
+constexpr bool
+isSpace(char c) noexcept
+{
+  return (c == ' ') || (c == '\t') || (c == '\r');
+}
+
+constexpr bool
+isDigit(char c) noexcept
+{
+  return (c >= '0') && (c <= '9');
+}
+
+const char*
+skipSpaces(const char* p, const char* end) noexcept
+{
+  while ((p != end) && isSpace(*p))
+    p++;
+
+  return p;
+}
+
+/// Parses a floating point number. Plain decimal and scientific notations are handled directly, which covers what
+/// exporters write in practice, and anything else is handed to the standard library.
+///
+/// @return A pointer past the number, or null if there is no number.
+const char*
+parseFloat(const char* p, const char* end, float& value) noexcept
+{
+  static const double powersOf10[]{ 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+  p = skipSpaces(p, end);
+
+  const char* start = p;
+
+  bool negative = false;
+
+  if ((p != end) && ((*p == '-') || (*p == '+')))
+    negative = *p++ == '-';
+
+  std::uint64_t mantissa = 0;
+
+  int exponent = 0;
+
+  int digitCount = 0;
+
+  for (; (p != end) && isDigit(*p); p++, digitCount++) {
+    if (mantissa < 1000000000000000000ull)
+      mantissa = (mantissa * 10) + std::uint64_t(*p - '0');
+    else
+      exponent++;
+  }
+
+  if ((p != end) && (*p == '.')) {
+    for (p++; (p != end) && isDigit(*p); p++, digitCount++) {
+      if (mantissa < 1000000000000000000ull) {
+        mantissa = (mantissa * 10) + std::uint64_t(*p - '0');
+        exponent--;
+      }
     }
+  }
 
-    for (std::size_t i = 0; i < shape.mesh.indices.size(); i += 3) {
+  if ((p != end) && ((*p == 'e') || (*p == 'E')) && digitCount) {
 
-      const tinyobj::mesh_t& mesh = shape.mesh;
+    const char* exponentStart = p++;
 
-      const tinyobj::index_t a = mesh.indices[i];
-      const tinyobj::index_t b = mesh.indices[i + 1];
-      const tinyobj::index_t c = mesh.indices[i + 2];
+    bool negativeExponent = false;
 
-      if (!isGoodIndex(a) || !isGoodIndex(b) || !isGoodIndex(c))
-        return false;
+    if ((p != end) && ((*p == '-') || (*p == '+')))
+      negativeExponent = *p++ == '-';
 
-      const Vertex vertices[3]{ { getPos(a), getNormal(a), getTexCoord(a) },
-                                { getPos(b), getNormal(b), getTexCoord(b) },
-                                { getPos(c), getNormal(c), getTexCoord(c) } };
+    if ((p == end) || !isDigit(*p)) {
+      p = exponentStart;
+    } else {
 
-      const int materialIndex = mesh.material_ids[i / 3];
+      int explicitExponent = 0;
 
-      shapeMap[materialIndex].vertices.emplace_back(vertices[0]);
-      shapeMap[materialIndex].vertices.emplace_back(vertices[1]);
-      shapeMap[materialIndex].vertices.emplace_back(vertices[2]);
+      for (; (p != end) && isDigit(*p); p++)
+        explicitExponent = std::min((explicitExponent * 10) + (*p - '0'), 100000);
+
+      exponent += negativeExponent ? -explicitExponent : explicitExponent;
     }
   }
 
-  for (auto& shapeEntry : shapeMap) {
-    m_impl->m_shapes.emplace_back(std::move(shapeEntry.second));
+  if (!digitCount || ((p != end) && !isSpace(*p) && (*p != '\n') && (*p != '/'))) {
+
+    // Not a number that the fast path understands, such as "nan" or "inf".
+
+    char buffer[64];
+
+    const std::size_t length = std::min(std::size_t(end - start), sizeof(buffer) - 1);
+
+    std::memcpy(buffer, start, length);
+
+    buffer[length] = 0;
+
+    char* parseEnd = nullptr;
+
+    value = std::strtof(buffer, &parseEnd);
+
+    return (parseEnd == buffer) ? nullptr : start + (parseEnd - buffer);
   }
 
-  return true;
+  double result = double(mantissa);
+
+  if ((exponent >= 0) && (exponent <= 22))
+    result *= powersOf10[exponent];
+  else if ((exponent < 0) && (exponent >= -22))
+    result /= powersOf10[-exponent];
+  else
+    result *= std::pow(10.0, exponent);
+
+  value = float(negative ? -result : result);
+
+  return p;
 }
 
-std::vector<ObjMeshModel::ShapeView>
-ObjMeshModel::getShapeViews() const
+/// Parses an index of a face corner, leaving @p index untouched if there is none.
+///
+/// @param elementCount The number of elements of the chunk so far, which relative indices are based on.
+const char*
+parseIndex(const char* p, const char* end, int& index, std::size_t elementCount) noexcept
 {
-  std::vector<ShapeView> shapeViews;
+  bool negative = false;
 
-  if (!m_impl)
-    return shapeViews;
+  if ((p != end) && (*p == '-')) {
+    negative = true;
+    p++;
+  }
 
-  for (const Shape& shape : m_impl->m_shapes) {
+  if ((p == end) || !isDigit(*p))
+    return p;
 
-    static_assert(sizeof(Vertex) == (sizeof(float) * 8)); // <- ensure the vertex is packed.
+  std::int64_t value = 0;
 
-    ShapeView shapeView{ (const float*)shape.vertices.data(), shape.vertices.size() };
+  for (; (p != end) && isDigit(*p); p++)
+    value = std::min<std::int64_t>((value * 10) + (*p - '0'), std::int64_t(1) << 40);
 
-    shapeViews.emplace_back(std::move(shapeView));
+  if (negative) {
+    const std::int64_t relative = std::int64_t(elementCount) - value;
+    index = int(std::max(relative - relativeObjIndexBias, std::int64_t(missingObjIndex) + 1));
+  } else if (value == 0) {
+    index = missingObjIndex;
+  } else {
+    index = int(std::min<std::int64_t>(value - 1, relativeObjIndexBias - 1));
   }
 
-  return shapeViews;
+  return p;
+}
+
+/// Gets the rest of a line, without the surrounding spaces.
+std::string
+parseName(const char* p, const char* end)
+{
+  p = skipSpaces(p, end);
+
+  while ((end != p) && isSpace(end[-1]))
+    end--;
+
+  return std::string(p, end);
+}
+
+void
+parseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+  int currentMaterial = -1;
+
+  std::vector<VertexKey> polygon;
+
+  while (p != end) {
+
+    const char* lineEnd = static_cast<const char*>(std::memchr(p, '\n', std::size_t(end - p)));
+
+    if (!lineEnd)
+      lineEnd = end;
+
+    const char* q = skipSpaces(p, lineEnd);
+
+    const std::size_t length = std::size_t(lineEnd - q);
+
+    if ((length >= 2) && (q[0] == 'v') && isSpace(q[1])) {
+
+      float xyz[3]{};
+
+      const char* r = q + 1;
+
+      for (int i = 0; (i < 3) && r; i++)
+        r = parseFloat(r, lineEnd, xyz[i]);
+
+      if (!r)
+        chunk.ok = false;
+
+      chunk.positions.insert(chunk.positions.end(), xyz, xyz + 3);
+
+    } else if ((length >= 3) && (q[0] == 'v') && (q[1] == 'n') && isSpace(q[2])) {
+
+      float xyz[3]{};
+
+      const char* r = q + 2;
+
+      for (int i = 0; (i < 3) && r; i++)
+        r = parseFloat(r, lineEnd, xyz[i]);
+
+      if (!r)
+        chunk.ok = false;
+
+      chunk.normals.insert(chunk.normals.end(), xyz, xyz + 3);
+
+    } else if ((length >= 3) && (q[0] == 'v') && (q[1] == 't') && isSpace(q[2])) {
+
+      float uv[2]{};
+
+      const char* r = parseFloat(q + 2, lineEnd, uv[0]);
+
+      if (!r)
+        chunk.ok = false;
+      else if (skipSpaces(r, lineEnd) != lineEnd)
+        parseFloat(r, lineEnd, uv[1]);
+
+      chunk.texCoords.insert(chunk.texCoords.end(), uv, uv + 2);
+
+    } else if ((length >= 2) && (q[0] == 'f') && isSpace(q[1])) {
+
+      polygon.clear();
+
+      const std::size_t positionCount = chunk.positions.size() / 3;
+      const std::size_t normalCount = chunk.normals.size() / 3;
+      const std::size_t texCoordCount = chunk.texCoords.size() / 2;
+
+      for (const char* r = skipSpaces(q + 1, lineEnd); r != lineEnd; r = skipSpaces(r, lineEnd)) {
+
+        VertexKey corner{ missingObjIndex, missingObjIndex, missingObjIndex };
+
+        const char* cornerStart = r;
+
+        r = parseIndex(r, lineEnd, corner.vertexIndex, positionCount);
+
+        if ((r != lineEnd) && (*r == '/'))
+          r = parseIndex(r + 1, lineEnd, corner.texCoordIndex, texCoordCount);
+
+        if ((r != lineEnd) && (*r == '/'))
+          r = parseIndex(r + 1, lineEnd, corner.normalIndex, normalCount);
+
+        if ((r == cornerStart) || ((r != lineEnd) && !isSpace(*r))) {
+          chunk.ok = false;
+          break;
+        }
+
+        polygon.emplace_back(corner);
+      }
+
+      // Other polygons are split into a fan of triangles.
+
+      if (polygon.size() == 4)
+        chunk.quads.emplace_back(chunk.triangleMaterials.size());
+
+      for (std::size_t i = 2; i < polygon.size(); i++) {
+
+        chunk.corners.emplace_back(polygon[0]);
+        chunk.corners.emplace_back(polygon[i - 1]);
+        chunk.corners.emplace_back(polygon[i]);
+
+        chunk.triangleMaterials.emplace_back(currentMaterial);
+      }
+
+    } else if ((length >= 7) && (std::memcmp(q, "usemtl", 6) == 0) && isSpace(q[6])) {
+
+      chunk.materialNames.emplace_back(parseName(q + 6, lineEnd));
+
+      currentMaterial = int(chunk.materialNames.size() - 1);
+
+    } else if ((length >= 7) && (std::memcmp(q, "mtllib", 6) == 0) && isSpace(q[6])) {
+
+      chunk.materialLibraries.emplace_back(parseName(q + 6, lineEnd));
+    }
+
+    p = (lineEnd == end) ? end : (lineEnd + 1);
+  }
+}
+
+/// Splits a file into chunks that start at the beginning of a line.
+std::vector<std::pair<std::size_t, std::size_t>>
+splitIntoLines(const char* text, std::size_t size, std::size_t chunkCount)
+{
+  std::vector<std::pair<std::size_t, std::size_t>> ranges;
+
+  std::size_t begin = 0;
+
+  for (std::size_t i = 1; (i <= chunkCount) && (begin < size); i++) {
+
+    std::size_t end = (i == chunkCount) ? size : ((size / chunkCount) * i);
+
+    end = std::max(end, begin);
+
+    const void* newline = (end < size) ? std::memchr(text + end, '\n', size - end) : nullptr;
+
+    end = newline ? std::size_t(static_cast<const char*>(newline) - text) + 1 : size;
+
+    ranges.emplace_back(begin, end);
+
+    begin = end;
+  }
+
+  return ranges;
+}
+
+/// Maps an OBJ file into memory. An empty file cannot be mapped, but it is a valid OBJ file without any shape, so it is
+/// opened with no data instead of failing.
+bool
+openObjFile(MappedFile& file, const char* path)
+{
+  if (file.open(path))
+    return true;
+
+  std::ifstream stream(path, std::ios::binary | std::ios::ate);
+
+  return stream.good() && (stream.tellg() == std::streampos(0));
+}
+
+/// The materials of an OBJ file. The id of a material is its index in @ref ObjMaterials::materials.
+struct ObjMaterials final
+{
+  std::map<std::string, int> materialMap;
+
+  std::vector<tinyobj::material_t> materials;
+
+  /// The directory of the library that defined each material, which its texture paths are relative to.
+  std::vector<std::string> materialDirectories;
+
+  std::vector<std::string> loadedLibraries;
+};
+
+/// Gets the id of a material by its name, or -1 if it is not defined. The id always indexes @ref
+/// ObjMaterials::materials, even when a name was defined more than once and the map kept a later definition.
+int
+findMaterialId(const ObjMaterials& materials, const std::string& name)
+{
+  const auto it = materials.materialMap.find(name);
+
+  if (it == materials.materialMap.end())
+    return -1;
+
+  const int id = it->second;
+
+  return ((id >= 0) && (std::size_t(id) < materials.materials.size())) ? id : -1;
+}
+
+/// Gets the directory of a file, including the trailing separator, which the files it refers to are relative to.
+std::string
+getDirectory(const char* path)
+{
+  const std::string directory(path);
+
+  const std::size_t separator = directory.find_last_of("/\\");
+
+  return (separator == std::string::npos) ? std::string() : directory.substr(0, separator + 1);
+}
+
+bool
+isAbsolutePath(const std::string& path) noexcept
+{
+  if (!path.empty() && ((path[0] == '/') || (path[0] == '\\')))
+    return true;
+
+  // A Windows drive letter, such as "C:".
+  return (path.size() >= 2) && std::isalpha(static_cast<unsigned char>(path[0])) && (path[1] == ':');
+}
+
+/// Resolves a path found in a file against the directory of that file. Empty and absolute paths are kept as they are.
+std::string
+resolvePath(const std::string& path, const std::string& directory)
+{
+  return (path.empty() || isAbsolutePath(path)) ? path : (directory + path);
+}
+
+std::vector<std::string>
+splitPath(const std::string& path)
+{
+  std::vector<std::string> components;
+
+  std::size_t begin = 0;
+
+  while (begin < path.size()) {
+
+    const std::size_t end = std::min(path.find_first_of("/\\", begin), path.size());
+
+    const std::string component = path.substr(begin, end - begin);
+
+    if (!component.empty() && (component != "."))
+      components.emplace_back(component);
+
+    begin = end + 1;
+  }
+
+  return components;
+}
+
+/// Makes a path relative to a directory, which is the inverse of @ref resolvePath. This only looks at the text of the
+/// paths, so it works with files that do not exist yet. A path that cannot be made relative, because only one of the
+/// two is absolute or the directory goes up past their common part, is returned as it is.
+std::string
+makeRelativePath(const std::string& path, const std::string& directory)
+{
+  if (path.empty() || (isAbsolutePath(path) != isAbsolutePath(directory)))
+    return path;
+
+  const std::vector<std::string> pathComponents = splitPath(path);
+
+  const std::vector<std::string> directoryComponents = splitPath(directory);
+
+  std::size_t common = 0;
+
+  while ((common < pathComponents.size()) && (common < directoryComponents.size()) &&
+         (pathComponents[common] == directoryComponents[common]))
+    common++;
+
+  std::string relativePath;
+
+  for (std::size_t i = common; i < directoryComponents.size(); i++) {
+
+    if (directoryComponents[i] == "..")
+      return path;
+
+    relativePath += "../";
+  }
+
+  for (std::size_t i = common; i < pathComponents.size(); i++) {
+    relativePath += pathComponents[i];
+    relativePath += (i + 1) < pathComponents.size() ? "/" : "";
+  }
+
+  return relativePath;
+}
+
+/// Loads the material libraries referenced by the chunks of an OBJ file, which are looked up next to it. Libraries
+/// that were already loaded are skipped, so this can be called again as more of the file is parsed.
+void
+loadMaterialLibraries(const char* objPath, const std::vector<ObjChunk>& chunks, ObjMaterials& materials)
+{
+  const std::string directory = getDirectory(objPath);
+
+  std::vector<std::string>& loadedLibraries = materials.loadedLibraries;
+
+  for (const ObjChunk& chunk : chunks) {
+
+    for (const std::string& library : chunk.materialLibraries) {
+
+      if (std::find(loadedLibraries.begin(), loadedLibraries.end(), library) != loadedLibraries.end())
+        continue;
+
+      loadedLibraries.emplace_back(library);
+
+      const std::string libraryPath = directory + library;
+
+      std::ifstream file(libraryPath);
+
+      if (!file.good())
+        continue;
+
+      std::string warning;
+
+      std::string error;
+
+      tinyobj::LoadMtl(&materials.materialMap, &materials.materials, &file, &warning, &error);
+
+      // The library may be in another directory than the OBJ file, such as a subdirectory of it.
+      materials.materialDirectories.resize(materials.materials.size(), getDirectory(libraryPath.c_str()));
+    }
+  }
+}
+
+/// Splits the contents of the file into chunks for the threads to parse. The chunks are small enough for the threads
+/// to balance the work among themselves, but large enough to keep the cost of merging them low.
+std::size_t
+getObjChunkCount(std::size_t fileSize)
+{
+  const std::size_t minChunkSize = 1024 * 1024;
+
+  const std::size_t threadCount = std::max(1u, std::thread::hardware_concurrency());
+
+  return std::max<std::size_t>(1, std::min(threadCount * 8, fileSize / minChunkSize));
+}
+
+/// What the lines before a list of chunks left behind: the number of vertices they defined and the material that was in
+/// use at the end of them.
+struct ObjChunkBases final
+{
+  std::size_t positionBase = 0;
+
+  std::size_t normalBase = 0;
+
+  std::size_t texCoordBase = 0;
+
+  int material = -1;
+};
+
+/// Resolves the indices and materials of the chunks, and checks that every corner has a position, a normal and a
+/// texture coordinate within range.
+///
+/// @param bases The state at the start of the first chunk, which is advanced past the last chunk.
+bool
+resolveObjChunks(std::vector<ObjChunk>& chunks,
+                 const ObjMaterials& materials,
+                 const std::vector<float>& positions,
+                 std::size_t normalCount,
+                 std::size_t texCoordCount,
+                 ObjChunkBases& bases)
+{
+  // Material ids index the vector of materials, which also holds the definitions that a duplicate name replaced in the
+  // map, so the number of names would be too small.
+  const std::size_t materialCount = materials.materials.size();
+
+  const std::size_t positionCount = positions.size() / 3;
+
+  std::vector<std::size_t> positionBases(chunks.size());
+  std::vector<std::size_t> normalBases(chunks.size());
+  std::vector<std::size_t> texCoordBases(chunks.size());
+
+  std::vector<int> inheritedMaterials(chunks.size());
+
+  std::size_t& positionBase = bases.positionBase;
+  std::size_t& normalBase = bases.normalBase;
+  std::size_t& texCoordBase = bases.texCoordBase;
+
+  int& inheritedMaterial = bases.material;
+
+  for (std::size_t i = 0; i < chunks.size(); i++) {
+
+    positionBases[i] = positionBase;
+    normalBases[i] = normalBase;
+    texCoordBases[i] = texCoordBase;
+
+    positionBase += chunks[i].positions.size() / 3;
+    normalBase += chunks[i].normals.size() / 3;
+    texCoordBase += chunks[i].texCoords.size() / 2;
+
+    inheritedMaterials[i] = inheritedMaterial;
+
+    if (!chunks[i].materialNames.empty())
+      inheritedMaterial = findMaterialId(materials, chunks[i].materialNames.back());
+  }
+
+  bool ok = true;
+
+  const std::ptrdiff_t chunkCount = std::ptrdiff_t(chunks.size());
+
+#pragma omp parallel for schedule(dynamic, 1) reduction(&& : ok)
+  for (std::ptrdiff_t i = 0; i < chunkCount; i++) {
+
+    ObjChunk& chunk = chunks[i];
+
+    auto resolve = [](int& index, std::size_t base, std::size_t count) -> bool {
+      if (index == missingObjIndex)
+        return false;
+
+      const std::int64_t absolute = (index < 0) ? (std::int64_t(base) + index + relativeObjIndexBias) : index;
+
+      if ((absolute < 0) || (absolute >= std::int64_t(count)))
+        return false;
+
+      index = int(absolute);
+
+      return true;
+    };
+
+    for (VertexKey& corner : chunk.corners) {
+      chunk.ok = chunk.ok && resolve(corner.vertexIndex, positionBases[i], positionCount);
+      chunk.ok = chunk.ok && resolve(corner.normalIndex, normalBases[i], normalCount);
+      chunk.ok = chunk.ok && resolve(corner.texCoordIndex, texCoordBases[i], texCoordCount);
+    }
+
+    for (std::size_t j = 0; chunk.ok && (j < chunk.quads.size()); j++) {
+
+      // The quad was split as (0, 1, 2) and (0, 2, 3), which is kept if 0-2 is the shortest diagonal.
+
+      VertexKey* corners = &chunk.corners[chunk.quads[j] * 3];
+
+      const VertexKey quad[4]{ corners[0], corners[1], corners[2], corners[5] };
+
+      auto squaredDistance = [&positions](const VertexKey& a, const VertexKey& b) -> float {
+        const float* p = &positions[std::size_t(a.vertexIndex) * 3];
+        const float* q = &positions[std::size_t(b.vertexIndex) * 3];
+        return ((q[0] - p[0]) * (q[0] - p[0])) + ((q[1] - p[1]) * (q[1] - p[1])) + ((q[2] - p[2]) * (q[2] - p[2]));
+      };
+
+      if (squaredDistance(quad[0], quad[2]) < squaredDistance(quad[1], quad[3]))
+        continue;
+
+      const VertexKey split[6]{ quad[0], quad[1], quad[3], quad[1], quad[2], quad[3] };
+
+      std::copy(split, split + 6, corners);
+    }
+
+    std::vector<int> materialIds(chunk.materialNames.size());
+
+    for (std::size_t j = 0; j < materialIds.size(); j++)
+      materialIds[j] = findMaterialId(materials, chunk.materialNames[j]);
+
+    // Material -1 is counted in the first slot, so the counts are shifted by one.
+
+    chunk.materialTriangleCounts.assign(materialCount + 1, 0);
+
+    for (int& material : chunk.triangleMaterials) {
+
+      material = (material == -1) ? inheritedMaterials[i] : materialIds[material];
+
+      chunk.materialTriangleCounts[material + 1]++;
+    }
+
+    ok = ok && chunk.ok;
+  }
+
+  return ok;
+}
+
+/// @param directory The directory of the library that defined the material, see @ref ObjMaterials::materialDirectories.
+Material
+makeMaterial(const tinyobj::material_t& objMaterial, const std::string& directory)
+{
+  Material material;
+
+  material.name = objMaterial.name;
+
+  for (int i = 0; i < 3; i++) {
+    material.albedo[i] = float(objMaterial.diffuse[i]);
+    material.emission[i] = float(objMaterial.emission[i]);
+  }
+
+  material.albedoTexture = resolvePath(objMaterial.diffuse_texname, directory);
+
+  material.emissionTexture = resolvePath(objMaterial.emissive_texname, directory);
+
+  material.normalTexture =
+    resolvePath(objMaterial.normal_texname.empty() ? objMaterial.bump_texname : objMaterial.normal_texname, directory);
+
+  return material;
+}
+
+/// Converts the materials that were loaded since the last call, so that the converted materials keep matching the
+/// material ids as more libraries are loaded.
+void
+convertNewMaterials(const ObjMaterials& materials, std::vector<Material>& converted)
+{
+  for (std::size_t i = converted.size(); i < materials.materials.size(); i++)
+    converted.emplace_back(makeMaterial(materials.materials[i], materials.materialDirectories[i]));
+}
+
+Vertex
+makeVertex(const VertexKey& key,
+           const std::vector<float>& positions,
+           const std::vector<float>& normals,
+           const std::vector<float>& texCoords) noexcept
+{
+  const float* p = &positions[std::size_t(key.vertexIndex) * 3];
+  const float* n = &normals[std::size_t(key.normalIndex) * 3];
+  const float* t = &texCoords[std::size_t(key.texCoordIndex) * 2];
+
+  return Vertex{ glm::vec3(p[0], p[1], p[2]), glm::vec3(n[0], n[1], n[2]), glm::vec2(t[0], t[1]) };
+}
+
+/// The size of the LRU cache simulated by the vertex cache optimization. This is larger than the FIFO caches of most
+/// GPUs, which is what the algorithm is tuned for.
+constexpr int forsythCacheSize = 32;
+
+/// Computes the score of a vertex in Tom Forsyth's vertex cache optimization, from its position in the simulated LRU
+/// cache (or -1 if it is not in it) and the number of triangles that still use it.
+float
+getForsythVertexScore(int cachePosition, std::uint32_t remainingTriangleCount) noexcept
+{
+  const float cacheDecayPower = 1.5f;
+  const float lastTriangleScore = 0.75f;
+  const float valenceBoostScale = 2.0f;
+  const float valenceBoostPower = 0.5f;
+
+  if (!remainingTriangleCount)
+    return -1.0f;
+
+  float score = 0;
+
+  if (cachePosition >= 0) {
+    if (cachePosition < 3) {
+      // The vertices of the last triangle get a fixed score, so that the next triangle does not just reuse them.
+      score = lastTriangleScore;
+    } else {
+      const float scale = 1.0f / float(forsythCacheSize - 3);
+      score = std::pow(1.0f - (float(cachePosition - 3) * scale), cacheDecayPower);
+    }
+  }
+
+  // Vertices with few triangles left get a boost, so that they are finished off and stop taking room in the cache.
+  score += valenceBoostScale * std::pow(float(remainingTriangleCount), -valenceBoostPower);
+
+  return score;
+}
+
+/// Indicates if a corner of a triangle uses the same vertex as an earlier corner, which happens in degenerate
+/// triangles. A vertex is only counted once per triangle, so that such triangles do not inflate its number of
+/// remaining triangles or take up several places in the simulated cache.
+bool
+isRepeatedCorner(const std::uint32_t* corners, std::size_t k) noexcept
+{
+  return ((k > 0) && (corners[k] == corners[0])) || ((k > 1) && (corners[k] == corners[1]));
+}
+
+/// Reorders triangles for the vertex cache with Tom Forsyth's algorithm. The next triangle is the one with the highest
+/// score among the triangles of the vertices in the cache, or the first remaining triangle when none of them is left.
+void
+optimizeTriangleOrder(std::vector<std::uint32_t>& indices, std::size_t vertexCount)
+{
+  const std::size_t triangleCount = indices.size() / 3;
+
+  // The triangles of each vertex, in compressed rows. Emitted triangles are swapped out of the end of each row.
+
+  std::vector<std::uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+
+  for (std::size_t i = 0; i < indices.size(); i++) {
+    if (!isRepeatedCorner(&indices[i - (i % 3)], i % 3))
+      adjacencyOffsets[indices[i] + 1]++;
+  }
+
+  for (std::size_t i = 0; i < vertexCount; i++)
+    adjacencyOffsets[i + 1] += adjacencyOffsets[i];
+
+  std::vector<std::uint32_t> remainingCounts(vertexCount, 0);
+
+  std::vector<std::uint32_t> adjacency(adjacencyOffsets[vertexCount]);
+
+  for (std::size_t i = 0; i < indices.size(); i++) {
+
+    if (isRepeatedCorner(&indices[i - (i % 3)], i % 3))
+      continue;
+
+    const std::uint32_t vertex = indices[i];
+
+    adjacency[adjacencyOffsets[vertex] + remainingCounts[vertex]++] = std::uint32_t(i / 3);
+  }
+
+  std::vector<int> cachePositions(vertexCount, -1);
+
+  std::vector<float> vertexScores(vertexCount);
+
+  for (std::size_t i = 0; i < vertexCount; i++)
+    vertexScores[i] = getForsythVertexScore(-1, remainingCounts[i]);
+
+  std::vector<bool> emittedFlags(triangleCount, false);
+
+  std::vector<std::uint32_t> newIndices;
+
+  newIndices.reserve(indices.size());
+
+  // The cache can hold three extra vertices while a triangle is being added.
+  std::uint32_t cache[forsythCacheSize + 3];
+
+  std::size_t cacheCount = 0;
+
+  std::size_t nextUnemitted = 0;
+
+  std::size_t bestTriangle = triangleCount;
+
+  while (newIndices.size() < indices.size()) {
+
+    if (bestTriangle == triangleCount) {
+
+      while (emittedFlags[nextUnemitted])
+        nextUnemitted++;
+
+      bestTriangle = nextUnemitted;
+    }
+
+    const std::uint32_t* corners = &indices[bestTriangle * 3];
+
+    emittedFlags[bestTriangle] = true;
+
+    newIndices.insert(newIndices.end(), corners, corners + 3);
+
+    // Remove the triangle from its vertices, then move its vertices to the front of the cache.
+
+    std::uint32_t newCache[forsythCacheSize + 3];
+
+    std::size_t newCacheCount = 0;
+
+    for (std::size_t k = 0; k < 3; k++) {
+
+      if (isRepeatedCorner(corners, k))
+        continue;
+
+      const std::uint32_t vertex = corners[k];
+
+      std::uint32_t* triangles = &adjacency[adjacencyOffsets[vertex]];
+
+      std::uint32_t& remainingCount = remainingCounts[vertex];
+
+      for (std::uint32_t j = 0; j < remainingCount; j++) {
+        if (triangles[j] == bestTriangle) {
+          triangles[j] = triangles[--remainingCount];
+          break;
+        }
+      }
+
+      newCache[newCacheCount++] = vertex;
+    }
+
+    for (std::size_t k = 0; k < cacheCount; k++) {
+      if ((cache[k] != corners[0]) && (cache[k] != corners[1]) && (cache[k] != corners[2]))
+        newCache[newCacheCount++] = cache[k];
+    }
+
+    // Update the scores of the vertices that were in the cache before or after the triangle, and of their triangles.
+
+    for (std::size_t k = 0; k < newCacheCount; k++) {
+      const std::uint32_t vertex = newCache[k];
+      cachePositions[vertex] = (k < forsythCacheSize) ? int(k) : -1;
+      vertexScores[vertex] = getForsythVertexScore(cachePositions[vertex], remainingCounts[vertex]);
+    }
+
+    cacheCount = std::min<std::size_t>(newCacheCount, forsythCacheSize);
+
+    std::copy(newCache, newCache + cacheCount, cache);
+
+    bestTriangle = triangleCount;
+
+    float bestScore = -1.0f;
+
+    for (std::size_t k = 0; k < cacheCount; k++) {
+
+      const std::uint32_t vertex = cache[k];
+
+      const std::uint32_t* triangles = &adjacency[adjacencyOffsets[vertex]];
+
+      for (std::uint32_t j = 0; j < remainingCounts[vertex]; j++) {
+
+        const std::uint32_t triangle = triangles[j];
+
+        const std::uint32_t* c = &indices[std::size_t(triangle) * 3];
+
+        // A repeated vertex still counts for each of its corners, which favors degenerate triangles. They do not
+        // load any new vertex, so they are best emitted while their vertices are in the cache.
+        const float score = vertexScores[c[0]] + vertexScores[c[1]] + vertexScores[c[2]];
+
+        if (score > bestScore) {
+          bestScore = score;
+          bestTriangle = triangle;
+        }
+      }
+    }
+  }
+
+  indices.swap(newIndices);
+}
+
+/// Reorders the vertices of a shape in the order that its triangles first use them. Unused vertices go last.
+void
+optimizeVertexOrder(Shape& shape)
+{
+  const std::uint32_t unassigned = std::numeric_limits<std::uint32_t>::max();
+
+  std::vector<std::uint32_t> remap(shape.vertices.size(), unassigned);
+
+  std::vector<Vertex> vertices;
+
+  vertices.reserve(shape.vertices.size());
+
+  for (std::uint32_t& index : shape.indices) {
+
+    if (remap[index] == unassigned) {
+      remap[index] = std::uint32_t(vertices.size());
+      vertices.emplace_back(shape.vertices[index]);
+    }
+
+    index = remap[index];
+  }
+
+  for (std::size_t i = 0; i < remap.size(); i++) {
+    if (remap[i] == unassigned)
+      vertices.emplace_back(shape.vertices[i]);
+  }
+
+  shape.vertices.swap(vertices);
+}
+
+} // namespace
+
+class ObjMeshModelImpl final
+{
+  friend ObjMeshModel;
+
+  std::vector<Shape> m_shapes;
+
+  /// The file loaded by @ref ObjMeshModel::loadBinary, which @ref ObjMeshModelImpl::m_mappedShapes point into.
+  MappedFile m_mappedFile;
+
+  std::vector<ObjMeshModel::ShapeView> m_mappedShapes;
+
+  /// The materials of @ref ObjMeshModelImpl::m_mappedShapes, which are copied out of the file.
+  std::vector<Material> m_mappedMaterials;
+};
+
+ObjMeshModel::ObjMeshModel()
+  : m_impl(new ObjMeshModelImpl())
+{}
+
+ObjMeshModel::ObjMeshModel(ObjMeshModel&& other)
+  : m_impl(other.m_impl)
+{
+  other.m_impl = nullptr;
+}
+
+ObjMeshModel&
+ObjMeshModel::operator=(ObjMeshModel&& other)
+{
+  std::swap(m_impl, other.m_impl);
+
+  return *this;
+}
+
+ObjMeshModel::~ObjMeshModel()
+{
+  delete m_impl;
+}
+
+bool
+ObjMeshModel::loadFile(const char* path, bool indexed)
+{
+  if (!m_impl)
+    m_impl = new ObjMeshModelImpl();
+
+  MappedFile file;
+
+  if (!openObjFile(file, path))
+    return false;
+
+  const char* text = static_cast<const char*>(file.data());
+
+  // Parse the chunks in parallel.
+
+  const std::vector<std::pair<std::size_t, std::size_t>> ranges =
+    splitIntoLines(text, file.size(), getObjChunkCount(file.size()));
+
+  std::vector<ObjChunk> chunks(ranges.size());
+
+  const std::ptrdiff_t chunkCount = std::ptrdiff_t(chunks.size());
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (std::ptrdiff_t i = 0; i < chunkCount; i++)
+    parseObjChunk(text + ranges[i].first, text + ranges[i].second, chunks[i]);
+
+  // Merge the vertex data of the chunks, which is in file order.
+
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> texCoords;
+
+  for (const ObjChunk& chunk : chunks) {
+    positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+    normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+    texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+  }
+
+  ObjMaterials materials;
+
+  loadMaterialLibraries(path, chunks, materials);
+
+  const std::size_t materialCount = materials.materials.size();
+
+  ObjChunkBases bases;
+
+  if (!resolveObjChunks(chunks, materials, positions, normals.size() / 3, texCoords.size() / 2, bases))
+    return false;
+
+  auto getVertex = [&positions, &normals, &texCoords](const VertexKey& key) -> Vertex {
+    return makeVertex(key, positions, normals, texCoords);
+  };
+
+  // Build one shape per material, in the order of the material ids, with the triangles in file order.
+
+  std::vector<std::size_t> shapeTriangleCounts(materialCount + 1, 0);
+
+  for (const ObjChunk& chunk : chunks)
+    for (std::size_t j = 0; j <= materialCount; j++)
+      shapeTriangleCounts[j] += chunk.materialTriangleCounts[j];
+
+  std::vector<Shape> shapes(materialCount + 1);
+
+  if (!indexed) {
+
+    // Each chunk writes its triangles at a precomputed offset in each shape, so the chunks can be copied in parallel.
+
+    std::vector<std::vector<std::size_t>> chunkOffsets(chunks.size(), std::vector<std::size_t>(materialCount + 1));
+
+    std::vector<std::size_t> offsets(materialCount + 1, 0);
+
+    for (std::size_t i = 0; i < chunks.size(); i++) {
+      for (std::size_t j = 0; j <= materialCount; j++) {
+        chunkOffsets[i][j] = offsets[j];
+        offsets[j] += chunks[i].materialTriangleCounts[j] * 3;
+      }
+    }
+
+    for (std::size_t j = 0; j <= materialCount; j++)
+      shapes[j].vertices.resize(shapeTriangleCounts[j] * 3);
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t i = 0; i < chunkCount; i++) {
+
+      const ObjChunk& chunk = chunks[i];
+
+      std::vector<std::size_t>& chunkOffset = chunkOffsets[i];
+
+      for (std::size_t j = 0; j < chunk.triangleMaterials.size(); j++) {
+
+        const std::size_t shapeIndex = std::size_t(chunk.triangleMaterials[j] + 1);
+
+        Vertex* vertices = &shapes[shapeIndex].vertices[chunkOffset[shapeIndex]];
+
+        for (std::size_t k = 0; k < 3; k++)
+          vertices[k] = getVertex(chunk.corners[(j * 3) + k]);
+
+        chunkOffset[shapeIndex] += 3;
+      }
+    }
+
+  } else {
+
+    // Deduplicating is sequential within a shape, but the shapes are independent of each other.
+
+    const std::ptrdiff_t shapeCount = std::ptrdiff_t(shapes.size());
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t j = 0; j < shapeCount; j++) {
+
+      if (!shapeTriangleCounts[j])
+        continue;
+
+      Shape& shape = shapes[j];
+
+      shape.indices.reserve(shapeTriangleCounts[j] * 3);
+
+      std::unordered_map<VertexKey, std::uint32_t, VertexKeyHash> vertexMap;
+
+      for (const ObjChunk& chunk : chunks) {
+
+        if (!chunk.materialTriangleCounts[j])
+          continue;
+
+        for (std::size_t k = 0; k < chunk.corners.size(); k++) {
+
+          if ((chunk.triangleMaterials[k / 3] + 1) != int(j))
+            continue;
+
+          const VertexKey& key = chunk.corners[k];
+
+          const auto [it, inserted] = vertexMap.emplace(key, std::uint32_t(shape.vertices.size()));
+
+          if (inserted)
+            shape.vertices.emplace_back(getVertex(key));
+
+          shape.indices.emplace_back(it->second);
+        }
+      }
+    }
+  }
+
+  // The shapes of a binary file loaded before are dropped, along with the mapping they point into, since they would
+  // otherwise be mixed with the shapes of this file.
+
+  m_impl->m_mappedShapes.clear();
+
+  m_impl->m_mappedMaterials.clear();
+
+  m_impl->m_mappedFile.close();
+
+  for (std::size_t j = 0; j <= materialCount; j++) {
+
+    if (!shapeTriangleCounts[j])
+      continue;
+
+    if (j > 0)
+      shapes[j].material = makeMaterial(materials.materials[j - 1], materials.materialDirectories[j - 1]);
+
+    m_impl->m_shapes.emplace_back(std::move(shapes[j]));
+  }
+
+  return true;
+}
+
+bool
+ObjMeshModel::streamFile(const char* path, std::size_t memoryBudget, const StreamCallback& callback)
+{
+  MappedFile file;
+
+  if (!openObjFile(file, path))
+    return false;
+
+  const char* text = static_cast<const char*>(file.data());
+
+  // A quarter of the budget goes to the text of the piece being parsed, about a half to its parsed contents (which are
+  // a little larger than the text), and the rest to the batch of triangles.
+
+  const std::size_t pieceSize = std::max<std::size_t>(memoryBudget / 4, 64 * 1024);
+
+  const std::size_t maxBatchSize = std::max<std::size_t>((((memoryBudget / 4) / sizeof(Vertex)) / 3) * 3, 3);
+
+  std::vector<float> positions;
+  std::vector<float> normals;
+  std::vector<float> texCoords;
+
+  ObjMaterials materials;
+
+  const Material defaultMaterial;
+
+  std::vector<Material> convertedMaterials;
+
+  ObjChunkBases bases;
+
+  std::vector<Vertex> batch;
+
+  int batchMaterial = -1;
+
+  auto flush = [&batch, &batchMaterial, &callback, &defaultMaterial, &convertedMaterials]() -> bool {
+    if (batch.empty())
+      return true;
+
+    ShapeView shapeView{ &batch[0].position[0], batch.size() };
+
+    shapeView.material = (batchMaterial < 0) ? &defaultMaterial : &convertedMaterials[std::size_t(batchMaterial)];
+
+    const bool keepGoing = callback(shapeView, batchMaterial);
+
+    batch.clear();
+
+    return keepGoing;
+  };
+
+  for (std::size_t pieceBegin = 0; pieceBegin < file.size();) {
+
+    std::size_t pieceEnd = std::min(pieceBegin + pieceSize, file.size());
+
+    const void* newline = std::memchr(text + pieceEnd - 1, '\n', file.size() - pieceEnd + 1);
+
+    pieceEnd = newline ? std::size_t(static_cast<const char*>(newline) - text) + 1 : file.size();
+
+    // The piece is parsed in parallel, in the same way as a whole file is by loadFile.
+
+    const char* pieceText = text + pieceBegin;
+
+    const std::size_t pieceLength = pieceEnd - pieceBegin;
+
+    const std::vector<std::pair<std::size_t, std::size_t>> ranges =
+      splitIntoLines(pieceText, pieceLength, getObjChunkCount(pieceLength));
+
+    std::vector<ObjChunk> chunks(ranges.size());
+
+    const std::ptrdiff_t chunkCount = std::ptrdiff_t(chunks.size());
+
+#pragma omp parallel for schedule(dynamic, 1)
+    for (std::ptrdiff_t i = 0; i < chunkCount; i++)
+      parseObjChunk(pieceText + ranges[i].first, pieceText + ranges[i].second, chunks[i]);
+
+    for (const ObjChunk& chunk : chunks) {
+      positions.insert(positions.end(), chunk.positions.begin(), chunk.positions.end());
+      normals.insert(normals.end(), chunk.normals.begin(), chunk.normals.end());
+      texCoords.insert(texCoords.end(), chunk.texCoords.begin(), chunk.texCoords.end());
+    }
+
+    loadMaterialLibraries(path, chunks, materials);
+
+    convertNewMaterials(materials, convertedMaterials);
+
+    if (!resolveObjChunks(chunks, materials, positions, normals.size() / 3, texCoords.size() / 2, bases))
+      return false;
+
+    for (const ObjChunk& chunk : chunks) {
+
+      for (std::size_t j = 0; j < chunk.triangleMaterials.size(); j++) {
+
+        if ((chunk.triangleMaterials[j] != batchMaterial) || (batch.size() == maxBatchSize)) {
+
+          if (!flush())
+            return false;
+
+          batchMaterial = chunk.triangleMaterials[j];
+        }
+
+        for (std::size_t k = 0; k < 3; k++)
+          batch.emplace_back(makeVertex(chunk.corners[(j * 3) + k], positions, normals, texCoords));
+      }
+    }
+
+    pieceBegin = pieceEnd;
+  }
+
+  return flush();
+}
+
+bool
+ObjMeshModel::saveBinary(const char* path) const
+{
+  const std::vector<ShapeView> shapeViews = getShapeViews();
+
+  std::FILE* file = std::fopen(path, "wb");
+  if (!file)
+    return false;
+
+  const BinaryHeader header = makeBinaryHeader(shapeViews.size());
+
+  // Lay out the strings and buffers first, so that the shape table can be written before them.
+
+  std::vector<BinaryShapeEntry> entries(shapeViews.size());
+
+  std::vector<std::string> materialStrings(shapeViews.size());
+
+  std::size_t offset = sizeof(BinaryHeader) + (entries.size() * sizeof(BinaryShapeEntry));
+
+  const std::string directory = getDirectory(path);
+
+  for (std::size_t i = 0; i < shapeViews.size(); i++) {
+
+    Material material = shapeViews[i].material ? *shapeViews[i].material : Material();
+
+    for (std::string* texturePath : getMaterialTexturePaths(material))
+      *texturePath = makeRelativePath(*texturePath, directory);
+
+    for (int j = 0; j < 3; j++) {
+      entries[i].albedo[j] = material.albedo[j];
+      entries[i].emission[j] = material.emission[j];
+    }
+
+    for (const std::string* str : getMaterialStrings(material)) {
+      materialStrings[i] += *str;
+      materialStrings[i] += '\0';
+    }
+
+    entries[i].stringOffset = offset;
+    entries[i].stringSize = materialStrings[i].size();
+
+    offset += materialStrings[i].size();
+  }
+
+  for (std::size_t i = 0; i < shapeViews.size(); i++) {
+
+    entries[i].vertexOffset = alignBinaryOffset(offset);
+    entries[i].vertexCount = shapeViews[i].vertexCount;
+
+    offset = entries[i].vertexOffset + (shapeViews[i].vertexCount * sizeof(Vertex));
+
+    entries[i].indexOffset = alignBinaryOffset(offset);
+    entries[i].indexCount = shapeViews[i].indexCount;
+
+    offset = entries[i].indexOffset + (shapeViews[i].indexCount * sizeof(std::uint32_t));
+  }
+
+  std::size_t writtenSize = 0;
+
+  auto writeAt = [file, &writtenSize](std::size_t offset, const void* data, std::size_t size) -> bool {
+    const unsigned char padding[binaryAlignment]{};
+
+    const std::size_t paddingSize = offset - writtenSize;
+
+    if (std::fwrite(padding, 1, paddingSize, file) != paddingSize)
+      return false;
+
+    if (size && (std::fwrite(data, 1, size, file) != size))
+      return false;
+
+    writtenSize = offset + size;
+
+    return true;
+  };
+
+  bool success = writeAt(0, &header, sizeof(header));
+
+  success = success && writeAt(sizeof(header), entries.data(), entries.size() * sizeof(BinaryShapeEntry));
+
+  for (std::size_t i = 0; i < shapeViews.size(); i++)
+    success = success && writeAt(entries[i].stringOffset, materialStrings[i].data(), materialStrings[i].size());
+
+  for (std::size_t i = 0; i < shapeViews.size(); i++) {
+
+    const std::size_t vertexSize = shapeViews[i].vertexCount * sizeof(Vertex);
+
+    const std::size_t indexSize = shapeViews[i].indexCount * sizeof(std::uint32_t);
+
+    success = success && writeAt(entries[i].vertexOffset, shapeViews[i].vertexBuffer, vertexSize);
+
+    success = success && writeAt(entries[i].indexOffset, shapeViews[i].indexBuffer, indexSize);
+  }
+
+  success = (std::fclose(file) == 0) && success;
+
+  if (!success)
+    std::remove(path);
+
+  return success;
+}
+
+bool
+ObjMeshModel::loadBinary(const char* path)
+{
+  if (!m_impl)
+    m_impl = new ObjMeshModelImpl();
+
+  MappedFile file;
+
+  if (!file.open(path) || (file.size() < sizeof(BinaryHeader)))
+    return false;
+
+  const unsigned char* bytes = static_cast<const unsigned char*>(file.data());
+
+  BinaryHeader header;
+
+  std::memcpy(&header, bytes, sizeof(header));
+
+  const BinaryHeader expected = makeBinaryHeader(header.shapeCount);
+
+  if (std::memcmp(&header, &expected, sizeof(header)) != 0)
+    return false;
+
+  if (header.shapeCount > ((file.size() - sizeof(header)) / sizeof(BinaryShapeEntry)))
+    return false;
+
+  std::vector<ShapeView> shapeViews;
+
+  std::vector<Material> materials;
+
+  const std::string directory = getDirectory(path);
+
+  for (std::size_t i = 0; i < header.shapeCount; i++) {
+
+    BinaryShapeEntry entry;
+
+    std::memcpy(&entry, bytes + sizeof(header) + (i * sizeof(entry)), sizeof(entry));
+
+    // Check the offsets and counts on their own first, so that computing the end of the buffers cannot overflow.
+
+    if ((entry.vertexOffset > file.size()) || (entry.indexOffset > file.size()) || (entry.stringOffset > file.size()))
+      return false;
+
+    if (entry.vertexCount > (file.size() / sizeof(Vertex)))
+      return false;
+
+    if (entry.indexCount > (file.size() / sizeof(std::uint32_t)))
+      return false;
+
+    if (entry.stringSize > (file.size() - entry.stringOffset))
+      return false;
+
+    Material material;
+
+    for (int j = 0; j < 3; j++) {
+      material.albedo[j] = entry.albedo[j];
+      material.emission[j] = entry.emission[j];
+    }
+
+    const char* strings = reinterpret_cast<const char*>(bytes + entry.stringOffset);
+
+    std::size_t position = 0;
+
+    for (std::string* str : getMaterialStrings(material)) {
+
+      const void* terminator = std::memchr(strings + position, '\0', std::size_t(entry.stringSize) - position);
+
+      if (!terminator)
+        return false;
+
+      const std::size_t length = std::size_t(static_cast<const char*>(terminator) - (strings + position));
+
+      str->assign(strings + position, length);
+
+      position += length + 1;
+    }
+
+    for (std::string* texturePath : getMaterialTexturePaths(material))
+      *texturePath = resolvePath(*texturePath, directory);
+
+    materials.emplace_back(std::move(material));
+
+    const std::uint64_t vertexEnd = entry.vertexOffset + (entry.vertexCount * sizeof(Vertex));
+
+    const std::uint64_t indexEnd = entry.indexOffset + (entry.indexCount * sizeof(std::uint32_t));
+
+    if ((vertexEnd > file.size()) || (indexEnd > file.size()))
+      return false;
+
+    if (((entry.vertexOffset % binaryAlignment) != 0) || ((entry.indexOffset % binaryAlignment) != 0))
+      return false;
+
+    ShapeView shapeView{ reinterpret_cast<const float*>(bytes + entry.vertexOffset), std::size_t(entry.vertexCount) };
+
+    if (entry.indexCount) {
+      shapeView.indexBuffer = reinterpret_cast<const std::uint32_t*>(bytes + entry.indexOffset);
+      shapeView.indexCount = std::size_t(entry.indexCount);
+    }
+
+    // The indices are used to look up vertices without any further check, so a single one out of range in a damaged
+    // file would read past the vertex buffer.
+
+    for (std::size_t j = 0; j < shapeView.indexCount; j++) {
+      if (shapeView.indexBuffer[j] >= entry.vertexCount)
+        return false;
+    }
+
+    shapeViews.emplace_back(shapeView);
+  }
+
+  // The materials are only pointed to once they are all read, since reading them may reallocate the array.
+
+  for (std::size_t i = 0; i < shapeViews.size(); i++)
+    shapeViews[i].material = &materials[i];
+
+  m_impl->m_shapes.clear();
+
+  m_impl->m_mappedFile = std::move(file);
+
+  m_impl->m_mappedShapes = std::move(shapeViews);
+
+  m_impl->m_mappedMaterials = std::move(materials);
+
+  return true;
+}
+
+void
+ObjMeshModel::optimizeVertexCache()
+{
+  if (!m_impl)
+    return;
+
+  std::vector<Shape>& shapes = m_impl->m_shapes;
+
+  const std::ptrdiff_t shapeCount = std::ptrdiff_t(shapes.size());
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (std::ptrdiff_t i = 0; i < shapeCount; i++) {
+
+    if (shapes[i].indices.empty())
+      continue;
+
+    optimizeTriangleOrder(shapes[i].indices, shapes[i].vertices.size());
+
+    optimizeVertexOrder(shapes[i]);
+  }
+}
+
+auto
+ObjMeshModel::analyzeVertexCache(const ShapeView& shapeView, std::size_t cacheSize) -> VertexCacheStats
+{
+  VertexCacheStats stats;
+
+  const std::size_t cornerCount = shapeView.triangleCount() * 3;
+
+  if (!cornerCount || !cacheSize)
+    return stats;
+
+  // Each vertex remembers when it entered the cache, so a lookup is a single comparison.
+
+  std::vector<std::size_t> entryTimestamps(shapeView.vertexCount, 0);
+
+  std::size_t timestamp = cacheSize + 1;
+
+  std::size_t missCount = 0;
+
+  for (std::size_t i = 0; i < cornerCount; i++) {
+
+    const std::size_t vertex = shapeView.vertexIndex(i);
+
+    if ((timestamp - entryTimestamps[vertex]) > cacheSize) {
+      entryTimestamps[vertex] = timestamp++;
+      missCount++;
+    }
+  }
+
+  stats.acmr = float(missCount) / float(cornerCount / 3);
+
+  stats.atvr = float(missCount) / float(shapeView.vertexCount);
+
+  return stats;
+}
+
+auto
+ObjMeshModel::computeBounds(const ShapeView& shapeView) -> Bounds
+{
+  Bounds bounds;
+
+  if (!shapeView.vertexCount)
+    return bounds;
+
+  glm::vec3 boxMin(std::numeric_limits<float>::max());
+  glm::vec3 boxMax(-std::numeric_limits<float>::max());
+
+  for (std::size_t i = 0; i < shapeView.vertexCount; i++) {
+    const glm::vec3 p(shapeView.px(i), shapeView.py(i), shapeView.pz(i));
+    boxMin = glm::min(boxMin, p);
+    boxMax = glm::max(boxMax, p);
+  }
+
+  for (int axis = 0; axis < 3; axis++) {
+
+    bounds.min[axis] = boxMin[axis];
+
+    bounds.max[axis] = boxMax[axis];
+  }
+
+  return bounds;
+}
+
+auto
+ObjMeshModel::packShape(const ShapeView& shapeView, bool uniformScale) -> PackedShape
+{
+  static_assert(sizeof(PackedVertex) == 16);
+
+  PackedShape packedShape;
+
+  packedShape.material = shapeView.material;
+
+  if (shapeView.isIndexed())
+    packedShape.indices.assign(shapeView.indexBuffer, shapeView.indexBuffer + shapeView.indexCount);
+
+  const std::ptrdiff_t vertexCount = std::ptrdiff_t(shapeView.vertexCount);
+
+  if (!vertexCount)
+    return packedShape;
+
+  const Bounds bounds = computeBounds(shapeView);
+
+  const glm::vec3 boxMin(bounds.min[0], bounds.min[1], bounds.min[2]);
+  const glm::vec3 boxMax(bounds.max[0], bounds.max[1], bounds.max[2]);
+
+  glm::vec3 extent = boxMax - boxMin;
+
+  if (uniformScale)
+    extent = glm::vec3(std::max(extent.x, std::max(extent.y, extent.z)));
+
+  // A flat box has a scale of zero on that axis, in which case every position is encoded as zero.
+  glm::vec3 inverseScale(0.0f);
+
+  for (int axis = 0; axis < 3; axis++) {
+
+    packedShape.positionOffset[axis] = boxMin[axis];
+
+    packedShape.positionScale[axis] = extent[axis];
+
+    if (extent[axis] > 0)
+      inverseScale[axis] = 65535.0f / extent[axis];
+  }
+
+  packedShape.vertices.resize(shapeView.vertexCount);
+
+#pragma omp parallel for
+  for (std::ptrdiff_t i = 0; i < vertexCount; i++) {
+
+    const glm::vec3 p(shapeView.px(i), shapeView.py(i), shapeView.pz(i));
+
+    const glm::vec3 q = glm::clamp((p - boxMin) * inverseScale, glm::vec3(0.0f), glm::vec3(65535.0f));
+
+    PackedVertex& vertex = packedShape.vertices[i];
+
+    vertex.position = PackedPosition{ std::uint16_t(std::lround(q.x)),
+                                      std::uint16_t(std::lround(q.y)),
+                                      std::uint16_t(std::lround(q.z)),
+                                      0 };
+
+    vertex.normal = packNormal(shapeView.nx(i), shapeView.ny(i), shapeView.nz(i));
+
+    vertex.texCoords = PackedTexCoords{ packHalf(shapeView.tx(i)), packHalf(shapeView.ty(i)) };
+  }
+
+  return packedShape;
+}
+
+void
+ObjMeshModel::addShape(const ShapeView& shapeView)
+{
+  if (!m_impl)
+    m_impl = new ObjMeshModelImpl();
+
+  Shape shape{};
+
+  if (shapeView.material)
+    shape.material = *shapeView.material;
+
+  const Vertex* vertices = reinterpret_cast<const Vertex*>(shapeView.vertexBuffer);
+
+  shape.vertices.assign(vertices, vertices + shapeView.vertexCount);
+
+  if (shapeView.isIndexed())
+    shape.indices.assign(shapeView.indexBuffer, shapeView.indexBuffer + shapeView.indexCount);
+
+  m_impl->m_shapes.emplace_back(std::move(shape));
+}
+
+float*
+ObjMeshModel::addShape(const Material& material, std::size_t vertexCount)
+{
+  if (!m_impl)
+    m_impl = new ObjMeshModelImpl();
+
+  Shape shape{};
+
+  shape.material = material;
+
+  shape.vertices.resize(vertexCount);
+
+  // Moving the shape into the array keeps its vertex buffer where it is.
+  float* vertexBuffer = reinterpret_cast<float*>(shape.vertices.data());
+
+  m_impl->m_shapes.emplace_back(std::move(shape));
+
+  return vertexBuffer;
+}
+
+std::vector<ObjMeshModel::ShapeView>
+ObjMeshModel::getShapeViews() const
+{
+  std::vector<ShapeView> shapeViews;
+
+  if (!m_impl)
+    return shapeViews;
+
+  shapeViews = m_impl->m_mappedShapes;
+
+  for (const Shape& shape : m_impl->m_shapes) {
+
+    static_assert(sizeof(Vertex) == (sizeof(float) * 8)); // <- ensure the vertex is packed.
+
+    ShapeView shapeView{ (const float*)shape.vertices.data(), shape.vertices.size() };
+
+    if (!shape.indices.empty()) {
+      shapeView.indexBuffer = shape.indices.data();
+      shapeView.indexCount = shape.indices.size();
+    }
+
+    shapeView.material = &shape.material;
+
+    shapeViews.emplace_back(std::move(shapeView));
+  }
+
+  return shapeViews;
+}
+
+std::uint64_t
+ObjMeshModel::computeHash() const
+{
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+
+  for (const ShapeView& shapeView : getShapeViews()) {
+
+    hash = fnv1a(hash, shapeView.vertexCount);
+
+    static_assert((sizeof(Vertex) % sizeof(std::uint64_t)) == 0);
+
+    const std::size_t wordCount = (shapeView.vertexCount * sizeof(Vertex)) / sizeof(std::uint64_t);
+
+    const unsigned char* bytes = (const unsigned char*)shapeView.vertexBuffer;
+
+    for (std::size_t i = 0; i < wordCount; i++) {
+
+      std::uint64_t word = 0;
+
+      std::memcpy(&word, bytes + (i * sizeof(word)), sizeof(word));
+
+      hash = fnv1a(hash, word);
+    }
+
+    hash = fnv1a(hash, shapeView.indexCount);
+
+    for (std::size_t i = 0; i < shapeView.indexCount; i++)
+      hash = fnv1a(hash, shapeView.indexBuffer[i]);
+  }
+
+  return hash;
 }
 
 } // namespace Ak
@@ -1,6 +1,8 @@
 #include <Ak/OpenGLFramebuffer.h>
 
+#include <Ak/OpenGLDirectStateAccess.h>
 #include <Ak/OpenGLRenderbuffer.h>
+#include <Ak/OpenGLStateCache.h>
 #include <Ak/OpenGLTexture2D.h>
 
 #include <cassert>
@@ -9,11 +11,16 @@ namespace Ak {
 
 OpenGLFramebuffer::OpenGLFramebuffer()
 {
-  glGenFramebuffers(1, &m_framebufferID);
+  if (isDirectStateAccessAvailable())
+    glCreateFramebuffers(1, &m_framebufferID);
+  else
+    glGenFramebuffers(1, &m_framebufferID);
 }
 
 OpenGLFramebuffer::~OpenGLFramebuffer()
 {
+  OpenGLStateCache::current().forgetFramebuffer(m_framebufferID);
+
   glDeleteFramebuffers(1, &m_framebufferID);
 }
 
@@ -22,7 +29,7 @@ OpenGLFramebuffer::bind()
 {
   assert(!m_boundFlag);
 
-  glBindFramebuffer(GL_FRAMEBUFFER, m_framebufferID);
+  OpenGLStateCache::current().bindFramebuffer(m_framebufferID);
 
   m_boundFlag = true;
 }
@@ -32,7 +39,7 @@ OpenGLFramebuffer::unbind()
 {
   assert(m_boundFlag);
 
-  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  OpenGLStateCache::current().bindFramebuffer(0);
 
   m_boundFlag = false;
 }
@@ -40,9 +47,12 @@ OpenGLFramebuffer::unbind()
 void
 OpenGLFramebuffer::attach(OpenGLRenderbuffer& renderbuffer)
 {
-  assert(m_boundFlag);
+  if (isDirectStateAccessAvailable()) {
+    glNamedFramebufferRenderbuffer(m_framebufferID, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffer.id());
+    return;
+  }
 
-  assert(renderbuffer.isBound());
+  OpenGLScopedBind<OpenGLFramebuffer> scopedBind(*this);
 
   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffer.id());
 }
@@ -56,28 +66,39 @@ OpenGLFramebuffer::attach(OpenGLTexture2D& texture)
 void
 OpenGLFramebuffer::attach(const std::vector<OpenGLTexture2D*>& textures)
 {
-  assert(m_boundFlag);
-
   assert(textures.size() <= 8);
 
   std::vector<GLenum> drawBuffers;
 
-  for (int i = 0; (i < int(textures.size())) && (i < 8); i++) {
+  for (int i = 0; (i < int(textures.size())) && (i < 8); i++)
+    drawBuffers.emplace_back(GL_COLOR_ATTACHMENT0 + i);
 
-    const GLenum colorAttachment = GL_COLOR_ATTACHMENT0 + i;
+  if (isDirectStateAccessAvailable()) {
 
-    drawBuffers.emplace_back(colorAttachment);
+    for (size_t i = 0; i < drawBuffers.size(); i++)
+      glNamedFramebufferTexture(m_framebufferID, drawBuffers[i], textures[i]->id(), 0);
 
-    glFramebufferTexture(GL_FRAMEBUFFER, colorAttachment, textures[i]->id(), 0);
+    glNamedFramebufferDrawBuffers(m_framebufferID, GLsizei(drawBuffers.size()), &drawBuffers[0]);
+
+    return;
   }
 
+  OpenGLScopedBind<OpenGLFramebuffer> scopedBind(*this);
+
+  for (size_t i = 0; i < drawBuffers.size(); i++)
+    glFramebufferTexture(GL_FRAMEBUFFER, drawBuffers[i], textures[i]->id(), 0);
+
   glDrawBuffers(drawBuffers.size(), &drawBuffers[0]);
 }
 
 bool
 OpenGLFramebuffer::isComplete() const
 {
-  assert(m_boundFlag);
+  if (isDirectStateAccessAvailable())
+    return glCheckNamedFramebufferStatus(m_framebufferID, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+  // Binding does not change the state of the framebuffer.
+  OpenGLScopedBind<OpenGLFramebuffer> scopedBind(const_cast<OpenGLFramebuffer&>(*this));
 
   return glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
 }
@@ -1,5 +1,6 @@
 #include <Ak/OpenGLHRTMeshRenderProgram.h>
 
+#include <Ak/OpenGLMeshBatch.h>
 #include <Ak/OpenGLVertexBuffer.h>
 
 #include <cassert>
@@ -13,57 +14,143 @@ OpenGLHRTMeshRenderProgram::OpenGLHRTMeshRenderProgram()
 
   m_mvpLocation = getUniformLocation("mvp");
 
+  m_positionTransformLocation = getUniformLocation("positionTransform");
+
   assert(m_mvpLocation >= 0);
 
-  unbind();
+  assert(m_positionTransformLocation >= 0);
 
-  m_framebuffer.bind();
-
-  m_renderbuffer.bind();
+  unbind();
 
   m_framebuffer.attach(m_renderbuffer);
 
-  m_renderbuffer.unbind();
-
   m_framebuffer.attach({ &m_albedoTexture, &m_normalDepthTexture });
-
-  m_framebuffer.unbind();
 }
 
 bool
 OpenGLHRTMeshRenderProgram::isInitialized()
+{
+  return m_framebuffer.isComplete();
+}
+
+void
+OpenGLHRTMeshRenderProgram::setMVP(const glm::mat4& mvp)
+{
+  assert(isBound());
+
+  setUniformValue(m_mvpLocation, mvp);
+}
+
+void
+OpenGLHRTMeshRenderProgram::clear()
 {
   m_framebuffer.bind();
 
-  const bool isFramebufferComplete = m_framebuffer.isComplete();
+  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-  m_framebuffer.unbind();
+  // Pixels that no mesh covers have the depth of the far plane, whatever the clear color is, since the depth is read
+  // back by passes such as occlusion culling.
+
+  const GLfloat normalDepthClearValue[4]{ 0, 0, 0, 1 };
 
-  return isFramebufferComplete;
+  glClearBufferfv(GL_COLOR, 1, normalDepthClearValue);
+
+  m_framebuffer.unbind();
 }
 
 void
-OpenGLHRTMeshRenderProgram::setMVP(const glm::mat4& mvp)
+OpenGLHRTMeshRenderProgram::setPositionTransform(const glm::mat4& positionTransform)
 {
   assert(isBound());
 
-  setUniformValue(m_mvpLocation, mvp);
+  setUniformValue(m_positionTransformLocation, positionTransform);
 }
 
 void
 OpenGLHRTMeshRenderProgram::render(const OpenGLVertexBuffer<glm::vec3, glm::vec3, glm::vec2>& vertexBuffer)
 {
-  glEnable(GL_DEPTH_TEST);
+  render(vertexBuffer, 0, GLsizei(vertexBuffer.getVertexCount()));
+}
+
+void
+OpenGLHRTMeshRenderProgram::render(const OpenGLVertexBuffer<glm::vec3, glm::vec3, glm::vec2>& vertexBuffer,
+                                   GLint firstVertex,
+                                   GLsizei vertexCount)
+{
+  assert(vertexBuffer.isBound());
+
+  assert(size_t(firstVertex + vertexCount) <= vertexBuffer.getVertexCount());
+
+  renderTriangles(firstVertex, vertexCount);
+}
+
+void
+OpenGLHRTMeshRenderProgram::render(
+  const OpenGLVertexBuffer<PackedPosition, PackedNormal, PackedTexCoords>& vertexBuffer)
+{
+  render(vertexBuffer, 0, GLsizei(vertexBuffer.getVertexCount()));
+}
 
+void
+OpenGLHRTMeshRenderProgram::render(
+  const OpenGLVertexBuffer<PackedPosition, PackedNormal, PackedTexCoords>& vertexBuffer,
+  GLint firstVertex,
+  GLsizei vertexCount)
+{
   assert(vertexBuffer.isBound());
 
+  assert(size_t(firstVertex + vertexCount) <= vertexBuffer.getVertexCount());
+
+  renderTriangles(firstVertex, vertexCount);
+}
+
+void
+OpenGLHRTMeshRenderProgram::renderTriangles(GLint firstVertex, GLsizei vertexCount, GLsizei instanceCount)
+{
+  glEnable(GL_DEPTH_TEST);
+
   assert(isBound());
 
   m_framebuffer.bind();
 
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+  glDrawArraysInstanced(GL_TRIANGLES, firstVertex, vertexCount, instanceCount);
+
+  m_framebuffer.unbind();
+
+  glDisable(GL_DEPTH_TEST);
+}
+
+void
+OpenGLHRTMeshRenderProgram::renderIndexedTriangles(GLenum indexType,
+                                                   size_t indexByteOffset,
+                                                   GLsizei indexCount,
+                                                   GLsizei instanceCount)
+{
+  glEnable(GL_DEPTH_TEST);
+
+  assert(isBound());
+
+  m_framebuffer.bind();
+
+  glDrawElementsInstanced(GL_TRIANGLES, indexCount, indexType, (const void*)indexByteOffset, instanceCount);
+
+  m_framebuffer.unbind();
+
+  glDisable(GL_DEPTH_TEST);
+}
+
+void
+OpenGLHRTMeshRenderProgram::render(const OpenGLMeshBatch& meshBatch)
+{
+  assert(meshBatch.isBound());
+
+  glEnable(GL_DEPTH_TEST);
+
+  assert(isBound());
+
+  m_framebuffer.bind();
 
-  glDrawArrays(GL_TRIANGLES, 0, vertexBuffer.getVertexCount());
+  glMultiDrawElementsIndirect(GL_TRIANGLES, meshBatch.getIndexType(), nullptr, meshBatch.getDrawCount(), 0);
 
   m_framebuffer.unbind();
 
@@ -73,17 +160,11 @@ OpenGLHRTMeshRenderProgram::render(const OpenGLVertexBuffer<glm::vec3, glm::vec3
 void
 OpenGLHRTMeshRenderProgram::resizeFramebuffer(int w, int h)
 {
-  m_renderbuffer.bind();
   m_renderbuffer.resize(w, h);
-  m_renderbuffer.unbind();
 
-  m_albedoTexture.bind();
   m_albedoTexture.resize(w, h, GL_RGB, GL_RGB, GL_FLOAT);
-  m_albedoTexture.unbind();
 
-  m_normalDepthTexture.bind();
   m_normalDepthTexture.resize(w, h, GL_RGBA32F, GL_RGBA, GL_FLOAT);
-  m_normalDepthTexture.unbind();
 }
 
 } // namespace Ak
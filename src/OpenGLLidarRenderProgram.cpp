@@ -1,5 +1,6 @@
 #include <Ak/OpenGLLidarRenderProgram.h>
 
+#include <Ak/OpenGLStreamingVertexBuffer.h>
 #include <Ak/OpenGLVertexBuffer.h>
 
 #include <cassert>
@@ -27,35 +28,17 @@ OpenGLLidarRenderProgram::OpenGLLidarRenderProgram()
 
   m_normalEstimationProgram.unbind();
 
-  m_framebuffer.bind();
-
-  m_depthBuffer.bind();
-
   m_framebuffer.attach(m_depthBuffer);
 
-  m_depthBuffer.unbind();
-
-  m_positionIntensityTexture.bind();
-
   m_positionIntensityTexture.setMinMagFilters(GL_NEAREST, GL_NEAREST);
 
   m_framebuffer.attach(m_positionIntensityTexture);
-
-  m_positionIntensityTexture.unbind();
-
-  m_framebuffer.unbind();
 }
 
 bool
 OpenGLLidarRenderProgram::isInitialized()
 {
-  m_framebuffer.bind();
-
-  bool isFramebufferComplete = m_framebuffer.isComplete();
-
-  m_framebuffer.unbind();
-
-  return isFramebufferComplete;
+  return m_framebuffer.isComplete();
 }
 
 void
@@ -80,9 +63,33 @@ OpenGLLidarRenderProgram::setEye(const glm::vec3& eye)
 
 void
 OpenGLLidarRenderProgram::render(const OpenGLVertexBuffer<glm::vec3, float>& lidarPoints)
+{
+  render(lidarPoints, 0, GLsizei(lidarPoints.getVertexCount()));
+}
+
+void
+OpenGLLidarRenderProgram::render(const OpenGLVertexBuffer<glm::vec3, float>& lidarPoints,
+                                 GLint firstVertex,
+                                 GLsizei vertexCount)
 {
   assert(lidarPoints.isBound());
 
+  assert(size_t(firstVertex + vertexCount) <= lidarPoints.getVertexCount());
+
+  renderPoints(firstVertex, vertexCount);
+}
+
+void
+OpenGLLidarRenderProgram::render(const OpenGLStreamingVertexBuffer<glm::vec3, float>& lidarPoints)
+{
+  assert(lidarPoints.isBound());
+
+  renderPoints(lidarPoints.getFirstVertex(), lidarPoints.getVertexCount());
+}
+
+void
+OpenGLLidarRenderProgram::renderPoints(GLint firstVertex, GLsizei vertexCount)
+{
   glEnable(GL_DEPTH_TEST);
 
   glEnable(GL_PROGRAM_POINT_SIZE);
@@ -96,18 +103,10 @@ OpenGLLidarRenderProgram::render(const OpenGLVertexBuffer<glm::vec3, float>& lid
   const GLint w = dims[2];
   const GLint h = dims[3];
 
-  m_positionIntensityTexture.bind();
-
   m_positionIntensityTexture.resize(w, h, GL_RGBA32F, GL_RGBA, GL_FLOAT);
 
-  m_positionIntensityTexture.unbind();
-
-  m_depthBuffer.bind();
-
   m_depthBuffer.resize(w, h);
 
-  m_depthBuffer.unbind();
-
   m_framebuffer.bind();
 
   m_renderLidarProgram.bind();
@@ -125,7 +124,7 @@ OpenGLLidarRenderProgram::render(const OpenGLVertexBuffer<glm::vec3, float>& lid
 
   glClearColor(originalClearColor[0], originalClearColor[1], originalClearColor[2], originalClearColor[3]);
 
-  glDrawArrays(GL_POINTS, 0, lidarPoints.getVertexCount());
+  glDrawArrays(GL_POINTS, firstVertex, vertexCount);
 
   m_renderLidarProgram.unbind();
 
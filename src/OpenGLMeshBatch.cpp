@@ -0,0 +1,186 @@
+#include <Ak/OpenGLMeshBatch.h>
+
+#include <Ak/OpenGLDirectStateAccess.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <cassert>
+
+namespace Ak {
+
+namespace {
+
+/// Gets the capacity that a buffer grows to when it has to fit a given number of elements.
+std::size_t
+getGrownCapacity(std::size_t capacity, std::size_t requiredCapacity) noexcept
+{
+  return std::max(requiredCapacity, capacity * 2);
+}
+
+/// Writes an element of a plain buffer object. Without direct state access, the data goes through the copy binding
+/// point, so that it works for any kind of buffer.
+template<typename Element>
+void
+writeElement(GLuint buffer, std::size_t index, const Element& element)
+{
+  const GLintptr byteOffset = GLintptr(index * sizeof(Element));
+
+  if (isDirectStateAccessAvailable()) {
+    glNamedBufferSubData(buffer, byteOffset, sizeof(Element), &element);
+    return;
+  }
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+
+  glBufferSubData(GL_COPY_WRITE_BUFFER, byteOffset, sizeof(Element), &element);
+
+  glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+} // namespace
+
+OpenGLMeshBatch::OpenGLMeshBatch()
+{
+  if (isDirectStateAccessAvailable()) {
+    glCreateBuffers(1, &m_indirectBuffer);
+    glCreateBuffers(1, &m_boundsBuffer);
+  } else {
+    glGenBuffers(1, &m_indirectBuffer);
+    glGenBuffers(1, &m_boundsBuffer);
+  }
+
+  // The index buffer and the per-shape transforms become part of the vertex array of the vertex buffer, so binding
+  // the vertex buffer is enough to draw.
+
+  m_indexBuffer.attach(m_vertexBuffer);
+
+  m_vertexBuffer.attach(m_transformBuffer);
+}
+
+OpenGLMeshBatch::~OpenGLMeshBatch()
+{
+  if (m_indirectBuffer)
+    glDeleteBuffers(1, &m_indirectBuffer);
+
+  if (m_boundsBuffer)
+    glDeleteBuffers(1, &m_boundsBuffer);
+}
+
+void
+OpenGLMeshBatch::addShape(const ObjMeshModel::ShapeView& shapeView)
+{
+  assert(!isBound());
+
+  if (!shapeView.vertexCount)
+    return;
+
+  // The positions are packed within a cube, so that their transform fits in the offset and scale of an instance.
+  const ObjMeshModel::PackedShape packedShape = ObjMeshModel::packShape(shapeView, true);
+
+  const std::size_t previousVertexCount = m_vertexBuffer.getVertexCount();
+
+  const std::size_t previousIndexCount = m_indexBuffer.getIndexCount();
+
+  // Shapes that are not indexed get an index per vertex, so that every shape is drawn by the same kind of command.
+
+  std::vector<std::uint32_t> sequentialIndices;
+
+  if (packedShape.indices.empty()) {
+    for (std::size_t i = 0; i < packedShape.vertices.size(); i++)
+      sequentialIndices.emplace_back(std::uint32_t(i));
+  }
+
+  const std::vector<std::uint32_t>& indices = packedShape.indices.empty() ? sequentialIndices : packedShape.indices;
+
+  // The buffers that are too small grow before the shape is written, keeping the shapes they already hold.
+
+  const std::size_t vertexCount = previousVertexCount + packedShape.vertices.size();
+
+  if (vertexCount > m_vertexBuffer.getVertexCapacity())
+    m_vertexBuffer.reserve(getGrownCapacity(m_vertexBuffer.getVertexCapacity(), vertexCount), GL_STATIC_DRAW);
+
+  const std::size_t indexCount = previousIndexCount + indices.size();
+
+  if (indexCount > m_indexBuffer.getIndexCapacity())
+    m_indexBuffer.reserve(getGrownCapacity(m_indexBuffer.getIndexCapacity(), indexCount), GL_STATIC_DRAW);
+
+  if (m_drawCount == m_drawCapacity) {
+
+    const std::size_t drawCapacity = getGrownCapacity(m_drawCapacity, m_drawCount + 1);
+
+    m_transformBuffer.reserve(drawCapacity, GL_STATIC_DRAW);
+
+    resizeBufferKeepingContents(m_indirectBuffer,
+                                GLsizeiptr(m_drawCount * sizeof(DrawCommand)),
+                                GLsizeiptr(drawCapacity * sizeof(DrawCommand)),
+                                GL_STATIC_DRAW);
+
+    resizeBufferKeepingContents(m_boundsBuffer,
+                                GLsizeiptr(m_drawCount * sizeof(ShapeBounds)),
+                                GLsizeiptr(drawCapacity * sizeof(ShapeBounds)),
+                                GL_STATIC_DRAW);
+
+    m_drawCapacity = drawCapacity;
+  }
+
+  static_assert(sizeof(VertexBuffer::Vertex) == sizeof(ObjMeshModel::PackedVertex));
+
+  const auto* vertices = reinterpret_cast<const VertexBuffer::Vertex*>(packedShape.vertices.data());
+
+  m_vertexBuffer.write(previousVertexCount, vertices, packedShape.vertices.size());
+
+  m_indexBuffer.write(previousIndexCount, indices.data(), indices.size());
+
+  TransformBuffer::Vertex transform;
+
+  const float* offset = packedShape.positionOffset;
+
+  transform.attribAt<0>().value = glm::vec4(offset[0], offset[1], offset[2], packedShape.positionScale[0]);
+
+  m_transformBuffer.write(m_drawCount, &transform, 1);
+
+  DrawCommand drawCommand{};
+
+  drawCommand.indexCount = GLuint(indices.size());
+
+  drawCommand.instanceCount = 1;
+
+  drawCommand.firstIndex = GLuint(previousIndexCount);
+
+  drawCommand.baseVertex = GLint(previousVertexCount);
+
+  drawCommand.baseInstance = GLuint(m_drawCount);
+
+  writeElement(m_indirectBuffer, m_drawCount, drawCommand);
+
+  const ObjMeshModel::Bounds bounds = ObjMeshModel::computeBounds(shapeView);
+
+  ShapeBounds shapeBounds;
+
+  shapeBounds.min = glm::vec4(bounds.min[0], bounds.min[1], bounds.min[2], 1);
+
+  shapeBounds.max = glm::vec4(bounds.max[0], bounds.max[1], bounds.max[2], 1);
+
+  writeElement(m_boundsBuffer, m_drawCount, shapeBounds);
+
+  m_drawCount++;
+}
+
+void
+OpenGLMeshBatch::bind()
+{
+  m_vertexBuffer.bind();
+
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, m_indirectBuffer);
+}
+
+void
+OpenGLMeshBatch::unbind()
+{
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+
+  m_vertexBuffer.unbind();
+}
+
+} // namespace Ak
@@ -0,0 +1,230 @@
+#include <Ak/OpenGLMeshCullingPass.h>
+
+#include <Ak/OpenGLDirectStateAccess.h>
+#include <Ak/OpenGLMeshBatch.h>
+#include <Ak/OpenGLStateCache.h>
+#include <Ak/OpenGLTexture2D.h>
+
+#include <glm/glm.hpp>
+
+#include <algorithm>
+
+#include <cassert>
+
+namespace Ak {
+
+namespace {
+
+// These match the local sizes declared in the compute shaders.
+
+constexpr GLuint depthPyramidGroupSize = 8;
+
+constexpr GLuint cullingGroupSize = 64;
+
+/// Gets the number of work groups that cover a given number of items.
+GLuint
+getGroupCount(GLuint itemCount, GLuint groupSize) noexcept
+{
+  return (itemCount + groupSize - 1) / groupSize;
+}
+
+} // namespace
+
+OpenGLMeshCullingPass::OpenGLMeshCullingPass()
+  : m_depthPyramidProgram(":/shaders/build_depth_pyramid.comp")
+  , m_cullingProgram(":/shaders/cull_mesh_batch.comp")
+{
+  m_depthPyramidProgram.bind();
+
+  m_sourceLevelLocation = m_depthPyramidProgram.getUniformLocation("sourceLevel");
+
+  m_sourceChannelLocation = m_depthPyramidProgram.getUniformLocation("sourceChannel");
+
+  assert(m_sourceLevelLocation >= 0);
+
+  assert(m_sourceChannelLocation >= 0);
+
+  m_depthPyramidProgram.unbind();
+
+  m_cullingProgram.bind();
+
+  m_viewProjectionLocation = m_cullingProgram.getUniformLocation("viewProjection");
+
+  m_drawCountLocation = m_cullingProgram.getUniformLocation("drawCount");
+
+  m_occlusionCullingEnabledLocation = m_cullingProgram.getUniformLocation("occlusionCullingEnabled");
+
+  assert(m_viewProjectionLocation >= 0);
+
+  assert(m_drawCountLocation >= 0);
+
+  assert(m_occlusionCullingEnabledLocation >= 0);
+
+  m_cullingProgram.unbind();
+
+  glGenTextures(1, &m_depthPyramid);
+}
+
+OpenGLMeshCullingPass::~OpenGLMeshCullingPass()
+{
+  if (m_depthPyramid) {
+    OpenGLStateCache::current().forgetTexture(m_depthPyramid);
+    glDeleteTextures(1, &m_depthPyramid);
+  }
+}
+
+bool
+OpenGLMeshCullingPass::isInitialized()
+{
+  return m_depthPyramidProgram.isLinked() && m_cullingProgram.isLinked();
+}
+
+void
+OpenGLMeshCullingPass::cull(const OpenGLMeshBatch& meshBatch, const glm::mat4& viewProjection)
+{
+  assert(!meshBatch.isBound());
+
+  const GLsizei drawCount = meshBatch.getDrawCount();
+
+  if (!drawCount)
+    return;
+
+  m_cullingProgram.bind();
+
+  m_cullingProgram.setUniformValue(m_viewProjectionLocation, viewProjection);
+
+  m_cullingProgram.setUniformValue(m_drawCountLocation, int(drawCount));
+
+  m_cullingProgram.setUniformValue(m_occlusionCullingEnabledLocation, int(m_depthPyramidValid));
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, meshBatch.boundsBufferID());
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, meshBatch.indirectBufferID());
+
+  OpenGLStateCache& stateCache = OpenGLStateCache::current();
+
+  stateCache.bindTexture2D(0, m_depthPyramidValid ? m_depthPyramid : 0);
+
+  glDispatchCompute(getGroupCount(GLuint(drawCount), cullingGroupSize), 1, 1);
+
+  stateCache.bindTexture2D(0);
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, 0);
+
+  glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, 0);
+
+  m_cullingProgram.unbind();
+
+  // The instance counts are written by the shader and read by the draw call as part of the indirect commands.
+
+  glMemoryBarrier(GL_COMMAND_BARRIER_BIT);
+}
+
+void
+OpenGLMeshCullingPass::updateDepthPyramid(OpenGLTexture2D& normalDepthTexture, int w, int h)
+{
+  if ((w <= 0) || (h <= 0)) {
+    invalidateDepthPyramid();
+    return;
+  }
+
+  if ((w != m_depthPyramidWidth) || (h != m_depthPyramidHeight))
+    resizeDepthPyramid(w, h);
+
+  m_depthPyramidProgram.bind();
+
+  // The first level is a copy of the depth channel, and every other level is reduced from the one before it.
+
+  buildDepthPyramidLevel(normalDepthTexture.id(), 0, 3, 0);
+
+  for (GLint level = 1; level < m_depthPyramidLevelCount; level++)
+    buildDepthPyramidLevel(m_depthPyramid, level - 1, 0, level);
+
+  m_depthPyramidProgram.unbind();
+
+  m_depthPyramidValid = true;
+}
+
+void
+OpenGLMeshCullingPass::resizeDepthPyramid(int w, int h)
+{
+  // The storage of a texture made with glTexStorage2D cannot change, so the texture is made again.
+
+  OpenGLStateCache& stateCache = OpenGLStateCache::current();
+
+  stateCache.forgetTexture(m_depthPyramid);
+
+  glDeleteTextures(1, &m_depthPyramid);
+
+  m_depthPyramidLevelCount = 1;
+
+  while ((std::max(w, h) >> m_depthPyramidLevelCount) > 0)
+    m_depthPyramidLevelCount++;
+
+  if (isDirectStateAccessAvailable()) {
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_depthPyramid);
+
+    glTextureStorage2D(m_depthPyramid, m_depthPyramidLevelCount, GL_R32F, w, h);
+
+    glTextureParameteri(m_depthPyramid, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+
+    glTextureParameteri(m_depthPyramid, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  } else {
+
+    glGenTextures(1, &m_depthPyramid);
+
+    stateCache.bindTexture2D(m_depthPyramid);
+
+    glTexStorage2D(GL_TEXTURE_2D, m_depthPyramidLevelCount, GL_R32F, w, h);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    stateCache.bindTexture2D(0);
+  }
+
+  m_depthPyramidWidth = w;
+
+  m_depthPyramidHeight = h;
+}
+
+void
+OpenGLMeshCullingPass::buildDepthPyramidLevel(GLuint sourceTexture,
+                                              GLint sourceLevel,
+                                              GLint sourceChannel,
+                                              GLint level)
+{
+  assert(m_depthPyramidProgram.isBound());
+
+  const GLuint levelWidth = GLuint(std::max(m_depthPyramidWidth >> level, 1));
+
+  const GLuint levelHeight = GLuint(std::max(m_depthPyramidHeight >> level, 1));
+
+  m_depthPyramidProgram.setUniformValue(m_sourceLevelLocation, int(sourceLevel));
+
+  m_depthPyramidProgram.setUniformValue(m_sourceChannelLocation, int(sourceChannel));
+
+  OpenGLStateCache& stateCache = OpenGLStateCache::current();
+
+  stateCache.bindTexture2D(0, sourceTexture);
+
+  glBindImageTexture(0, m_depthPyramid, level, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+  const GLuint groupCountX = getGroupCount(levelWidth, depthPyramidGroupSize);
+
+  const GLuint groupCountY = getGroupCount(levelHeight, depthPyramidGroupSize);
+
+  glDispatchCompute(groupCountX, groupCountY, 1);
+
+  glBindImageTexture(0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_R32F);
+
+  stateCache.bindTexture2D(0);
+
+  // The next level reads this one through a sampler, and culling reads the whole pyramid the same way.
+
+  glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT);
+}
+
+} // namespace Ak
@@ -31,12 +31,32 @@ OpenGLPointRenderProgram::setMVP(const glm::mat4& mvp)
 
 void
 OpenGLPointRenderProgram::render(OpenGLVertexBuffer<glm::vec3, glm::vec4>& buffer)
+{
+  render(buffer, 0, GLsizei(buffer.getVertexCount()));
+}
+
+void
+OpenGLPointRenderProgram::render(OpenGLVertexBuffer<glm::vec3, glm::vec4>& buffer,
+                                 GLint firstVertex,
+                                 GLsizei vertexCount)
+{
+  assert(isBound());
+
+  assert(buffer.isBound());
+
+  assert(size_t(firstVertex + vertexCount) <= buffer.getVertexCount());
+
+  glDrawArrays(GL_POINTS, firstVertex, vertexCount);
+}
+
+void
+OpenGLPointRenderProgram::renderInstanced(OpenGLVertexBuffer<glm::vec3, glm::vec4>& buffer, GLsizei instanceCount)
 {
   assert(isBound());
 
   assert(buffer.isBound());
 
-  glDrawArrays(GL_POINTS, 0, buffer.getVertexCount());
+  glDrawArraysInstanced(GL_POINTS, 0, GLsizei(buffer.getVertexCount()), instanceCount);
 }
 
 } // namespace Ak
@@ -1,12 +1,17 @@
 #include <Ak/OpenGLRenderbuffer.h>
 
+#include <Ak/OpenGLDirectStateAccess.h>
+
 #include <cassert>
 
 namespace Ak {
 
 OpenGLRenderbuffer::OpenGLRenderbuffer()
 {
-  glGenRenderbuffers(1, &m_renderbufferID);
+  if (isDirectStateAccessAvailable())
+    glCreateRenderbuffers(1, &m_renderbufferID);
+  else
+    glGenRenderbuffers(1, &m_renderbufferID);
 }
 
 OpenGLRenderbuffer::~OpenGLRenderbuffer()
@@ -38,7 +43,12 @@ OpenGLRenderbuffer::unbind()
 void
 OpenGLRenderbuffer::resize(int w, int h, GLenum internalFormat)
 {
-  assert(m_boundFlag);
+  if (isDirectStateAccessAvailable()) {
+    glNamedRenderbufferStorage(m_renderbufferID, internalFormat, w, h);
+    return;
+  }
+
+  OpenGLScopedBind<OpenGLRenderbuffer> scopedBind(*this);
 
   glRenderbufferStorage(GL_RENDERBUFFER, internalFormat, w, h);
 }
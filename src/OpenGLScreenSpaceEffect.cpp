@@ -12,13 +12,9 @@ OpenGLScreenSpaceEffect::OpenGLScreenSpaceEffect(const char* vertSource, const c
   };
   // clang-format on
 
-  m_quad.bind();
-
   m_quad.allocate(6, GL_STATIC_DRAW);
 
   m_quad.write(0, vertices, 6);
-
-  m_quad.unbind();
 }
 
 } // namespace Ak
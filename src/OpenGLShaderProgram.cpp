@@ -1,5 +1,7 @@
 #include <Ak/OpenGLShaderProgram.h>
 
+#include <Ak/OpenGLStateCache.h>
+
 #include <glm/glm.hpp>
 
 #include <cmrc/cmrc.hpp>
@@ -119,6 +121,32 @@ OpenGLShaderProgram::OpenGLShaderProgram(const char* vertSourcePath, const char*
   glDetachShader(m_programID, vertShader.getID());
   glDetachShader(m_programID, fragShader.getID());
 
+  readLinkInfoLog();
+}
+
+OpenGLShaderProgram::OpenGLShaderProgram(const char* compSourcePath)
+{
+  Shader<GL_COMPUTE_SHADER> compShader(compSourcePath);
+
+  m_compInfoLog = compShader.getInfoLog();
+
+  if (!compShader.isCompiled())
+    return;
+
+  m_programID = glCreateProgram();
+
+  glAttachShader(m_programID, compShader.getID());
+
+  glLinkProgram(m_programID);
+
+  glDetachShader(m_programID, compShader.getID());
+
+  readLinkInfoLog();
+}
+
+void
+OpenGLShaderProgram::readLinkInfoLog()
+{
   GLsizei infoLogLength = 0;
 
   glGetProgramiv(m_programID, GL_INFO_LOG_LENGTH, &infoLogLength);
@@ -138,8 +166,10 @@ OpenGLShaderProgram::OpenGLShaderProgram(const char* vertSourcePath, const char*
 
 OpenGLShaderProgram::~OpenGLShaderProgram()
 {
-  if (m_programID > 0u)
+  if (m_programID > 0u) {
+    OpenGLStateCache::current().forgetProgram(m_programID);
     glDeleteProgram(m_programID);
+  }
 }
 
 void
@@ -147,7 +177,7 @@ OpenGLShaderProgram::bind()
 {
   assert(!m_boundFlag);
 
-  glUseProgram(m_programID);
+  OpenGLStateCache::current().useProgram(m_programID);
 
   m_boundFlag = true;
 }
@@ -157,7 +187,7 @@ OpenGLShaderProgram::unbind()
 {
   assert(m_boundFlag);
 
-  glUseProgram(0);
+  OpenGLStateCache::current().releaseProgram(m_programID);
 
   m_boundFlag = false;
 }
@@ -187,6 +217,12 @@ OpenGLShaderProgram::getFragInfoLog() const
   return m_fragInfoLog;
 }
 
+std::string
+OpenGLShaderProgram::getCompInfoLog() const
+{
+  return m_compInfoLog;
+}
+
 std::string
 OpenGLShaderProgram::getLinkInfoLog() const
 {
@@ -0,0 +1,176 @@
+#include <Ak/OpenGLStateCache.h>
+
+#include <cassert>
+
+namespace Ak {
+
+OpenGLStateCache&
+OpenGLStateCache::current()
+{
+  thread_local OpenGLStateCache stateCache;
+
+  return stateCache;
+}
+
+OpenGLStateCache::OpenGLStateCache() noexcept
+{
+  invalidate();
+}
+
+void
+OpenGLStateCache::useProgram(GLuint programID)
+{
+  if (update(m_program, programID))
+    glUseProgram(programID);
+}
+
+void
+OpenGLStateCache::releaseProgram(GLuint programID)
+{
+  assert((m_program == programID) || (m_program == unknownBinding));
+
+  (void)programID;
+
+  // The call that unbinding would have made is saved, whatever is bound next.
+
+  m_counters.skippedCallCount++;
+}
+
+void
+OpenGLStateCache::bindVertexArray(GLuint vertexArrayID)
+{
+  if (update(m_vertexArray, vertexArrayID))
+    glBindVertexArray(vertexArrayID);
+}
+
+void
+OpenGLStateCache::releaseVertexArray(GLuint vertexArrayID)
+{
+  assert((m_vertexArray == vertexArrayID) || (m_vertexArray == unknownBinding));
+
+  (void)vertexArrayID;
+
+  m_counters.skippedCallCount++;
+}
+
+void
+OpenGLStateCache::bindFramebuffer(GLuint framebufferID)
+{
+  if (update(m_framebuffer, framebufferID))
+    glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+}
+
+void
+OpenGLStateCache::bindTexture2D(GLuint textureID)
+{
+  // Texture bindings are per unit, so the active unit is read back once if nothing has set it since the cache was
+  // invalidated.
+
+  if (m_activeTextureUnit == unknownBinding) {
+
+    GLint activeTexture = GL_TEXTURE0;
+
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &activeTexture);
+
+    m_activeTextureUnit = GLuint(activeTexture - GL_TEXTURE0);
+  }
+
+  if (m_activeTextureUnit >= maxCachedTextureUnits) {
+
+    m_counters.issuedCallCount++;
+
+    glBindTexture(GL_TEXTURE_2D, textureID);
+
+    return;
+  }
+
+  if (update(m_textures2D[m_activeTextureUnit], textureID))
+    glBindTexture(GL_TEXTURE_2D, textureID);
+}
+
+void
+OpenGLStateCache::bindTexture2D(GLuint unit, GLuint textureID)
+{
+  activeTexture(unit);
+
+  bindTexture2D(textureID);
+}
+
+void
+OpenGLStateCache::activeTexture(GLuint unit)
+{
+  if (update(m_activeTextureUnit, unit))
+    glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void
+OpenGLStateCache::forgetProgram(GLuint programID)
+{
+  // A deleted program stays in use until another one is, but its name may be given to a new program, which then has
+  // to be bound for real.
+
+  if (m_program == programID)
+    m_program = unknownBinding;
+}
+
+void
+OpenGLStateCache::forgetVertexArray(GLuint vertexArrayID)
+{
+  if (m_vertexArray == vertexArrayID)
+    m_vertexArray = 0;
+}
+
+void
+OpenGLStateCache::forgetFramebuffer(GLuint framebufferID)
+{
+  if (m_framebuffer == framebufferID)
+    m_framebuffer = 0;
+}
+
+void
+OpenGLStateCache::forgetTexture(GLuint textureID)
+{
+  for (GLuint& binding : m_textures2D) {
+    if (binding == textureID)
+      binding = 0;
+  }
+}
+
+void
+OpenGLStateCache::invalidate() noexcept
+{
+  m_program = unknownBinding;
+
+  m_vertexArray = unknownBinding;
+
+  m_framebuffer = unknownBinding;
+
+  m_activeTextureUnit = unknownBinding;
+
+  m_textures2D.fill(unknownBinding);
+}
+
+void
+OpenGLStateCache::endFrame() noexcept
+{
+  m_frameCounters = m_counters;
+
+  m_counters = Counters();
+}
+
+bool
+OpenGLStateCache::update(GLuint& binding, GLuint objectID) noexcept
+{
+  if (binding == objectID) {
+    m_counters.skippedCallCount++;
+    return false;
+  }
+
+  binding = objectID;
+
+  m_counters.issuedCallCount++;
+
+  return true;
+}
+
+} // namespace Ak
@@ -1,8 +1,12 @@
 #include <Ak/OpenGLTexture2D.h>
 
+#include <Ak/OpenGLDirectStateAccess.h>
+#include <Ak/OpenGLStateCache.h>
+
 #include <stb_image.h>
 #include <stb_image_write.h>
 
+#include <limits>
 #include <memory>
 
 #include <cassert>
@@ -11,6 +15,19 @@ namespace Ak {
 
 OpenGLTexture2D::OpenGLTexture2D()
 {
+  if (isDirectStateAccessAvailable()) {
+
+    glCreateTextures(GL_TEXTURE_2D, 1, &m_textureID);
+
+    glTextureParameteri(m_textureID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(m_textureID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+    glTextureParameteri(m_textureID, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTextureParameteri(m_textureID, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+    return;
+  }
+
   glGenTextures(1, &m_textureID);
 
   bind();
@@ -34,15 +51,15 @@ OpenGLTexture2D::OpenGLTexture2D(OpenGLTexture2D&& other)
 
 OpenGLTexture2D::~OpenGLTexture2D()
 {
-  if (m_textureID)
+  if (m_textureID) {
+    OpenGLStateCache::current().forgetTexture(m_textureID);
     glDeleteTextures(1, &m_textureID);
+  }
 }
 
 bool
 OpenGLTexture2D::openFile(const char* path, bool flipVertically)
 {
-  assert(m_boundFlag);
-
   int w = 0;
   int h = 0;
   int channelCount = 0;
@@ -73,7 +90,11 @@ OpenGLTexture2D::openFile(const char* path, bool flipVertically)
       break;
   }
 
-  glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, format, GL_UNSIGNED_BYTE, data);
+  {
+    OpenGLScopedBind<OpenGLTexture2D> scopedBind(*this);
+
+    glTexImage2D(GL_TEXTURE_2D, 0, format, w, h, 0, format, GL_UNSIGNED_BYTE, data);
+  }
 
   stbi_image_free(data);
 
@@ -83,8 +104,6 @@ OpenGLTexture2D::openFile(const char* path, bool flipVertically)
 bool
 OpenGLTexture2D::savePNG(const char* path, GLenum format, bool flipVertically)
 {
-  assert(m_boundFlag);
-
   int channelCount = 0;
 
   switch (format) {
@@ -105,13 +124,24 @@ OpenGLTexture2D::savePNG(const char* path, GLenum format, bool flipVertically)
   GLint w = 0;
   GLint h = 0;
 
-  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+  if (isDirectStateAccessAvailable()) {
+
+    glGetTextureLevelParameteriv(m_textureID, 0, GL_TEXTURE_WIDTH, &w);
 
-  glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+    glGetTextureLevelParameteriv(m_textureID, 0, GL_TEXTURE_HEIGHT, &h);
+
+  } else {
+
+    OpenGLScopedBind<OpenGLTexture2D> scopedBind(*this);
+
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &w);
+
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &h);
+  }
 
   std::unique_ptr<unsigned char[]> buffer(new unsigned char[w * h * channelCount]);
 
-  glGetTexImage(GL_TEXTURE_2D, 0, format, GL_UNSIGNED_BYTE, buffer.get());
+  read(0, format, GL_UNSIGNED_BYTE, buffer.get());
 
   stbi_flip_vertically_on_write(flipVertically);
 
@@ -121,7 +151,13 @@ OpenGLTexture2D::savePNG(const char* path, GLenum format, bool flipVertically)
 void
 OpenGLTexture2D::setMinMagFilters(GLenum minFilter, GLenum magFilter)
 {
-  assert(m_boundFlag);
+  if (isDirectStateAccessAvailable()) {
+    glTextureParameteri(m_textureID, GL_TEXTURE_MIN_FILTER, minFilter);
+    glTextureParameteri(m_textureID, GL_TEXTURE_MAG_FILTER, magFilter);
+    return;
+  }
+
+  OpenGLScopedBind<OpenGLTexture2D> scopedBind(*this);
 
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
   glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
@@ -132,7 +168,7 @@ OpenGLTexture2D::bind()
 {
   assert(m_boundFlag == false);
 
-  glBindTexture(GL_TEXTURE_2D, m_textureID);
+  OpenGLStateCache::current().bindTexture2D(m_textureID);
 
   m_boundFlag = true;
 }
@@ -142,7 +178,7 @@ OpenGLTexture2D::unbind()
 {
   assert(m_boundFlag == true);
 
-  glBindTexture(GL_TEXTURE_2D, 0);
+  OpenGLStateCache::current().bindTexture2D(0);
 
   m_boundFlag = false;
 }
@@ -150,7 +186,10 @@ OpenGLTexture2D::unbind()
 void
 OpenGLTexture2D::resize(GLint w, GLint h, GLenum internalFormat, GLenum format, GLenum type)
 {
-  assert(m_boundFlag);
+  // Direct state access only has immutable storage, which would need a new texture name and so break the framebuffers
+  // that the texture is attached to.
+
+  OpenGLScopedBind<OpenGLTexture2D> scopedBind(*this);
 
   glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, w, h, 0, format, type, nullptr);
 }
@@ -158,7 +197,12 @@ OpenGLTexture2D::resize(GLint w, GLint h, GLenum internalFormat, GLenum format,
 void
 OpenGLTexture2D::write(GLint x, GLint y, GLint w, GLint h, GLenum format, GLenum type, const void* pixels)
 {
-  assert(m_boundFlag);
+  if (isDirectStateAccessAvailable()) {
+    glTextureSubImage2D(m_textureID, 0, x, y, w, h, format, type, pixels);
+    return;
+  }
+
+  OpenGLScopedBind<OpenGLTexture2D> scopedBind(*this);
 
   glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, w, h, format, type, pixels);
 }
@@ -184,7 +228,15 @@ OpenGLTexture2D::write(GLint x, GLint y, GLint w, GLint h, const glm::vec4* rgba
 void
 OpenGLTexture2D::read(GLint level, GLenum format, GLenum type, void* pixels) const
 {
-  assert(m_boundFlag);
+  // The size of the destination is not known here, so it is left to the caller, like with glGetTexImage.
+
+  if (isDirectStateAccessAvailable()) {
+    glGetTextureImage(m_textureID, level, format, type, std::numeric_limits<GLsizei>::max(), pixels);
+    return;
+  }
+
+  // Binding does not change the contents of the texture.
+  OpenGLScopedBind<OpenGLTexture2D> scopedBind(const_cast<OpenGLTexture2D&>(*this));
 
   glGetTexImage(GL_TEXTURE_2D, level, format, type, pixels);
 }
@@ -0,0 +1,129 @@
+#include <Ak/OpenGLTextureCache.h>
+
+#include <Ak/ObjMeshModel.h>
+
+#include <stb_image.h>
+
+#include <algorithm>
+
+namespace Ak {
+
+namespace {
+
+struct DecodedImage final
+{
+  unsigned char* pixels = nullptr;
+
+  int width = 0;
+
+  int height = 0;
+};
+
+} // namespace
+
+std::size_t
+OpenGLTextureCache::load(const std::vector<std::string>& paths, bool flipVertically)
+{
+  std::vector<std::string> newPaths;
+
+  for (const std::string& path : paths) {
+    if (!path.empty() && (m_textures.find(path) == m_textures.end()))
+      newPaths.emplace_back(path);
+  }
+
+  std::sort(newPaths.begin(), newPaths.end());
+
+  newPaths.erase(std::unique(newPaths.begin(), newPaths.end()), newPaths.end());
+
+  // Decoding is by far the slowest part, and each image is independent of the others. The flag is set before the
+  // threads start, since it is global to stb_image.
+
+  stbi_set_flip_vertically_on_load(flipVertically);
+
+  std::vector<DecodedImage> images(newPaths.size());
+
+  const std::ptrdiff_t imageCount = std::ptrdiff_t(images.size());
+
+#pragma omp parallel for schedule(dynamic, 1)
+  for (std::ptrdiff_t i = 0; i < imageCount; i++) {
+
+    DecodedImage& image = images[i];
+
+    int channelCount = 0;
+
+    // Every image is expanded to RGBA, so that the rows are always aligned and all textures sample the same way.
+    image.pixels = stbi_load(newPaths[i].c_str(), &image.width, &image.height, &channelCount, 4);
+  }
+
+  std::size_t failureCount = 0;
+
+  for (std::size_t i = 0; i < images.size(); i++) {
+
+    std::unique_ptr<OpenGLTexture2D>& texture = m_textures[newPaths[i]];
+
+    if (!images[i].pixels) {
+      failureCount++;
+      continue;
+    }
+
+    texture.reset(new OpenGLTexture2D());
+
+    texture->bind();
+
+    texture->resize(images[i].width, images[i].height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE);
+
+    texture->write(0, 0, images[i].width, images[i].height, GL_RGBA, GL_UNSIGNED_BYTE, images[i].pixels);
+
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+    glGenerateMipmap(GL_TEXTURE_2D);
+
+    texture->setMinMagFilters(GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+
+    texture->unbind();
+
+    stbi_image_free(images[i].pixels);
+  }
+
+  return failureCount;
+}
+
+std::size_t
+OpenGLTextureCache::loadMaterialTextures(const ObjMeshModel& objMeshModel, bool flipVertically)
+{
+  std::vector<std::string> paths;
+
+  for (const ObjMeshModel::ShapeView& shapeView : objMeshModel.getShapeViews()) {
+
+    if (!shapeView.material)
+      continue;
+
+    paths.emplace_back(shapeView.material->albedoTexture);
+    paths.emplace_back(shapeView.material->emissionTexture);
+    paths.emplace_back(shapeView.material->normalTexture);
+  }
+
+  return load(paths, flipVertically);
+}
+
+OpenGLTexture2D*
+OpenGLTextureCache::find(const std::string& path) noexcept
+{
+  const auto it = m_textures.find(path);
+
+  return (it == m_textures.end()) ? nullptr : it->second.get();
+}
+
+std::size_t
+OpenGLTextureCache::getTextureCount() const noexcept
+{
+  std::size_t textureCount = 0;
+
+  for (const auto& entry : m_textures)
+    textureCount += entry.second ? 1 : 0;
+
+  return textureCount;
+}
+
+} // namespace Ak
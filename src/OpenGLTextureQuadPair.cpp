@@ -1,5 +1,6 @@
 #include <Ak/OpenGLTextureQuadPair.h>
 
+#include <Ak/OpenGLStateCache.h>
 #include <Ak/OpenGLTexture2D.h>
 
 namespace Ak {
@@ -14,7 +15,7 @@ OpenGLTextureQuadPair::OpenGLTextureQuadPair(OpenGLTexture2D* texture)
 {
   glGenVertexArrays(1, &m_vertexArrayObject);
 
-  glBindVertexArray(m_vertexArrayObject);
+  OpenGLStateCache::current().bindVertexArray(m_vertexArrayObject);
 
   glGenBuffers(1, &m_vertexBuffer);
 
@@ -37,27 +38,29 @@ OpenGLTextureQuadPair::OpenGLTextureQuadPair(OpenGLTexture2D* texture)
 
   glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, (void*)0);
 
-  glBindVertexArray(0);
+  OpenGLStateCache::current().releaseVertexArray(m_vertexArrayObject);
 }
 
 OpenGLTextureQuadPair::~OpenGLTextureQuadPair()
 {
   if (m_vertexArrayObject) {
 
-    glBindVertexArray(m_vertexArrayObject);
+    OpenGLStateCache::current().bindVertexArray(m_vertexArrayObject);
 
     glBindBuffer(GL_ARRAY_BUFFER, 0);
 
     glDisableVertexAttribArray(0);
 
-    glBindVertexArray(0);
+    OpenGLStateCache::current().releaseVertexArray(m_vertexArrayObject);
   }
 
   if (m_vertexBuffer)
     glDeleteBuffers(1, &m_vertexBuffer);
 
-  if (m_vertexArrayObject)
+  if (m_vertexArrayObject) {
+    OpenGLStateCache::current().forgetVertexArray(m_vertexArrayObject);
     glDeleteVertexArrays(1, &m_vertexArrayObject);
+  }
 }
 
 void
@@ -65,7 +68,7 @@ OpenGLTextureQuadPair::RenderProgram::render(OpenGLTextureQuadPair& textureQuadP
 {
   bind();
 
-  glBindVertexArray(textureQuadPair.getVertexArrayObjectID());
+  OpenGLStateCache::current().bindVertexArray(textureQuadPair.getVertexArrayObjectID());
 
   textureQuadPair.getTexturePtr()->bind();
 
@@ -73,7 +76,7 @@ OpenGLTextureQuadPair::RenderProgram::render(OpenGLTextureQuadPair& textureQuadP
 
   textureQuadPair.getTexturePtr()->unbind();
 
-  glBindVertexArray(0);
+  OpenGLStateCache::current().releaseVertexArray(textureQuadPair.getVertexArrayObjectID());
 
   unbind();
 }
@@ -1,6 +1,7 @@
 #include <Ak/SingleWindowGLFWApp.h>
 
 #include <Ak/GLFW.h>
+#include <Ak/OpenGLStateCache.h>
 
 #include <memory>
 #include <vector>
@@ -80,6 +81,8 @@ run(int argc, char** argv, SingleWindowGLFWApp::FactoryMethod factoryMethod)
 
           app->requestAnimationFrame(window);
 
+          OpenGLStateCache::current().endFrame();
+
           glfwSwapBuffers(window);
 
           GLFW::pollEvents();